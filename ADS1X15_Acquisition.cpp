@@ -0,0 +1,399 @@
+/**************************************************************************/
+/*!
+	@file     ADS1X15_Acquisition.cpp
+
+	Event-loop friendly acquisition of a group of channels.
+
+	@section license License
+
+	BSD license, all text here must be included in any redistribution
+*/
+/**************************************************************************/
+
+#include <sys/timerfd.h>
+
+#include "ADS1X15_Acquisition.h"
+#include "ADS1X15_Deadband.h"
+#include "ADS1X15_Recovery.h"
+
+/**************************************************************************/
+/*!
+	@brief  Instantiates an empty group
+*/
+/**************************************************************************/
+adsAcquisition::adsAcquisition()
+{
+	m_timerFd = -1;
+	m_filter = NULL;
+}
+
+/**************************************************************************/
+/*!
+	@brief  Stops the group and closes its file descriptor
+*/
+/**************************************************************************/
+adsAcquisition::~adsAcquisition()
+{
+	stop();
+}
+
+/**************************************************************************/
+/*!
+	@brief  Finds the entry of a device in the group
+
+	@return the entry, NULL if the device is not in the group yet
+*/
+/**************************************************************************/
+adsAcquisition::device_t* adsAcquisition::findDevice(TLA2024* device) {
+	for (size_t i = 0; i < m_devices.size(); i++)
+		if (m_devices[i].device == device)
+			return &m_devices[i];
+
+	return NULL;
+}
+
+/**************************************************************************/
+/*!
+	@brief  Adds a single-shot channel to the group.  The channels of a
+			device are converted in the order they were added.
+
+	@param device device to convert on, must outlive the group
+	@param input ADS_INPUT_* multiplexer setting
+
+	@return the channel index, -1 on error
+*/
+/**************************************************************************/
+int adsAcquisition::addChannel(TLA2024* device, uint8_t input) {
+	if (m_timerFd >= 0 || input >= ADS_INPUT_COUNT || m_channels.size() > 0xFF)
+		return -1;
+
+	device_t* entry = findDevice(device);
+	if (entry && m_channels[entry->channels[0]].comparator)
+		return -1;
+
+	channel_t channel;
+	channel.device = device;
+	channel.input = input;
+	channel.comparator = false;
+	channel.threshold = 0;
+	m_channels.push_back(channel);
+
+	if (!entry) {
+		device_t newDevice;
+		newDevice.device = device;
+		newDevice.next = 0;
+		newDevice.deadlineNs = 0;
+		m_devices.push_back(newDevice);
+		entry = &m_devices.back();
+	}
+	entry->channels.push_back(m_channels.size() - 1);
+
+	return m_channels.size() - 1;
+}
+
+/**************************************************************************/
+/*!
+	@brief  Adds a comparator channel to the group.  The device runs in
+			continuous mode (see startComparator_SingleEnded()) and every
+			conversion is reported with the alert flag set when it reached
+			the threshold.  The device cannot have other channels.
+
+	@param device device to convert on, must outlive the group
+	@param channel ADC channel to use
+	@param threshold comparator threshold
+
+	@return the channel index, -1 on error
+*/
+/**************************************************************************/
+int adsAcquisition::addComparator(ADS1015* device, uint8_t channel, int16_t threshold) {
+	if (m_timerFd >= 0 || channel > 3 || findDevice(device) || m_channels.size() > 0xFF)
+		return -1;
+
+	channel_t entry;
+	entry.device = device;
+	entry.input = ADS_INPUT_SINGLE(channel);
+	entry.comparator = true;
+	entry.threshold = threshold;
+	m_channels.push_back(entry);
+
+	device_t newDevice;
+	newDevice.device = device;
+	newDevice.channels.push_back(m_channels.size() - 1);
+	newDevice.next = 0;
+	newDevice.deadlineNs = 0;
+	m_devices.push_back(newDevice);
+
+	return m_channels.size() - 1;
+}
+
+/**************************************************************************/
+/*!
+	@brief  Starts the first conversion of every device and creates the
+			file descriptor
+
+	@return 1 on success, -1 on error
+*/
+/**************************************************************************/
+int adsAcquisition::start() {
+	if (m_timerFd >= 0)
+		return 1;
+
+	m_timerFd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+	if (m_timerFd < 0) {
+		fprintf(stderr, "Error while creating the acquisition timer! Error: %s\n", strerror(errno));
+		return -1;
+	}
+
+	uint64_t now = adsTimestampNs();
+	for (size_t i = 0; i < m_devices.size(); i++)
+	{
+		device_t* device = &m_devices[i];
+		channel_t* channel = &m_channels[device->channels[0]];
+		if (channel->comparator)
+			((ADS1015*)device->device)->startComparator_SingleEnded(channel->input - ADS_INPUT_SINGLE_0, channel->threshold);
+
+		device->next = 0;
+		startConversion(device, now);
+	}
+	armTimer();
+
+	return 1;
+}
+
+/**************************************************************************/
+/*!
+	@brief  Closes the file descriptor.  Conversions in progress are
+			dropped, comparator devices keep converting.
+*/
+/**************************************************************************/
+void adsAcquisition::stop() {
+	if (m_timerFd < 0)
+		return;
+
+	close(m_timerFd);
+	m_timerFd = -1;
+}
+
+/**************************************************************************/
+/*!
+	@brief  Gets the file descriptor to poll for readability
+
+	@return the timerfd, -1 if the group is not started
+*/
+/**************************************************************************/
+int adsAcquisition::fd() const {
+	return m_timerFd;
+}
+
+/**************************************************************************/
+/*!
+	@brief  Starts the current conversion of a device
+
+	@param device device entry
+	@param nowNs current time
+*/
+/**************************************************************************/
+void adsAcquisition::startConversion(device_t* device, uint64_t nowNs) {
+	channel_t* channel = &m_channels[device->channels[device->next]];
+
+	// Comparator devices convert continuously, only the delay is tracked
+	if (!channel->comparator)
+		device->device->startADC_Input(channel->input);
+
+	device->deadlineNs = nowNs + (uint64_t)device->device->getConversionDelay() * 1000;
+}
+
+/**************************************************************************/
+/*!
+	@brief  Arms the timer for the earliest conversion deadline
+*/
+/**************************************************************************/
+void adsAcquisition::armTimer() {
+	if (m_timerFd < 0 || m_devices.empty())
+		return;
+
+	uint64_t deadline = m_devices[0].deadlineNs;
+	for (size_t i = 1; i < m_devices.size(); i++)
+		if (m_devices[i].deadlineNs < deadline)
+			deadline = m_devices[i].deadlineNs;
+
+	// A deadline in the past makes the fd readable immediately
+	struct itimerspec spec;
+	memset(&spec, 0, sizeof(spec));
+	spec.it_value.tv_sec = deadline / 1000000000ULL;
+	spec.it_value.tv_nsec = deadline % 1000000000ULL;
+	timerfd_settime(m_timerFd, TFD_TIMER_ABSTIME, &spec, NULL);
+}
+
+/**************************************************************************/
+/*!
+	@brief  Collects the finished conversions and starts the next ones.
+			Never sleeps; call it when fd() is readable.  If samples is
+			too small the fd stays readable until the rest is drained.
+
+	@param samples output samples
+	@param maxSamples size of samples
+
+	@return the number of samples written
+*/
+/**************************************************************************/
+size_t adsAcquisition::drain(adsSample_t* samples, size_t maxSamples) {
+	return collect(samples, maxSamples, m_filter);
+}
+
+/**************************************************************************/
+/*!
+	@brief  Collects the finished conversions, feeds the sinks and starts
+			the next conversions
+
+	@param samples output samples
+	@param maxSamples size of samples
+	@param filter selects the samples written, NULL for all
+
+	@return the number of samples written
+*/
+/**************************************************************************/
+size_t adsAcquisition::collect(adsSample_t* samples, size_t maxSamples, adsDeadband* filter) {
+	if (m_timerFd < 0)
+		return 0;
+
+	// Clear the readability, EAGAIN is fine
+	uint64_t expirations;
+	if (read(m_timerFd, &expirations, sizeof(expirations)) < 0 && errno != EAGAIN)
+		return 0;
+
+	size_t count = 0;
+	uint64_t now = adsTimestampNs();
+	for (size_t i = 0; i < m_devices.size() && count < maxSamples; i++)
+	{
+		device_t* device = &m_devices[i];
+		if (device->deadlineNs > now)
+			continue;
+
+		// Checked again at the recovery monitor pace until it is back
+		if (!device->device->isAvailable()) {
+			device->deadlineNs = now + (uint64_t)ADS_RECOVERY_CHECK_INTERVAL * 1000000;
+			continue;
+		}
+
+		uint8_t index = device->channels[device->next];
+		channel_t* channel = &m_channels[index];
+		if (!channel->comparator && !device->device->isConversionReady()) {
+			device->deadlineNs = now + ADS_ACQ_POLL_INTERVAL * 1000;
+			continue;
+		}
+
+		// No sample while the result is stale or the read failed
+		int16_t value;
+		if (device->device->readConversionResult(&value) < 0) {
+			device->deadlineNs = now + ADS_ACQ_POLL_INTERVAL * 1000;
+			continue;
+		}
+
+		adsSample_t* sample = &samples[count++];
+		sample->value = value;
+		sample->timestampNs = adsTimestampNs();
+		sample->channel = index;
+		sample->input = channel->input;
+		sample->alert = channel->comparator && sample->value >= channel->threshold;
+
+		for (size_t j = 0; j < m_sinks.size(); j++)
+			m_sinks[j]->onSample(*sample);
+
+		// The sinks see every sample, the caller only the reported ones
+		if (filter && !filter->filter(*sample))
+			count--;
+
+		device->next = (device->next + 1) % device->channels.size();
+		startConversion(device, sample->timestampNs);
+	}
+	armTimer();
+
+	return count;
+}
+
+/**************************************************************************/
+/*!
+	@brief  Collects the finished conversions straight into the columns
+			of a block.  Block channel i receives group channel i, so the
+			block must have at least channelCount() channels.  Samples of a
+			channel whose column is already full are dropped; channels
+			converted at different rates should go to different blocks.
+			The filter is not applied, a block keeps every sample.
+
+	@param block block to fill
+
+	@return the number of samples appended
+*/
+/**************************************************************************/
+size_t adsAcquisition::drain(adsSampleBlock& block) {
+	if (block.channelCount() < m_channels.size())
+		return 0;
+
+	adsSample_t samples[ADS_INPUT_COUNT * 4];
+	size_t maxSamples = block.capacity() - block.size();
+	if (maxSamples > sizeof(samples) / sizeof(samples[0]))
+		maxSamples = sizeof(samples) / sizeof(samples[0]);
+
+	size_t appended = 0;
+	size_t count = collect(samples, maxSamples, NULL);
+	for (size_t i = 0; i < count; i++)
+		if (block.appendSample(samples[i].channel, samples[i].value, samples[i].timestampNs) > 0)
+			appended++;
+
+	return appended;
+}
+
+/**************************************************************************/
+/*!
+	@brief  Adds a stage fed with every sample drained from the group
+
+	@param sink stage to feed, must outlive the group
+*/
+/**************************************************************************/
+void adsAcquisition::addSink(adsSampleSink* sink) {
+	m_sinks.push_back(sink);
+}
+
+/**************************************************************************/
+/*!
+	@brief  Filters the samples returned by drain(), e.g. with a deadband.
+			The conversions and the sinks keep the full rate.  Do not add
+			the filter as a sink too, it would see every sample twice.
+			drain(adsSampleBlock&) bypasses the filter: its columns must
+			fill evenly, one timestamp per row.
+
+	@param filter filter indexed by group channel, must outlive the group,
+			NULL to return every sample
+*/
+/**************************************************************************/
+void adsAcquisition::setFilter(adsDeadband* filter) {
+	m_filter = filter;
+}
+
+/**************************************************************************/
+/*!
+	@brief  Gets the number of channels in the group
+*/
+/**************************************************************************/
+size_t adsAcquisition::channelCount() const {
+	return m_channels.size();
+}
+
+/**************************************************************************/
+/*!
+	@brief  Gets the ADS_INPUT_* multiplexer setting of a channel
+*/
+/**************************************************************************/
+uint8_t adsAcquisition::channelInput(uint8_t channel) const {
+	return channel < m_channels.size() ? m_channels[channel].input : 0;
+}
+
+/**************************************************************************/
+/*!
+	@brief  Gets the device a channel converts on
+*/
+/**************************************************************************/
+TLA2024* adsAcquisition::channelDevice(uint8_t channel) const {
+	return channel < m_channels.size() ? m_channels[channel].device : NULL;
+}
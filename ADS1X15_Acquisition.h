@@ -0,0 +1,85 @@
+/**************************************************************************/
+/*!
+    @file     ADS1X15_Acquisition.h
+
+    Event-loop friendly acquisition of a group of channels.
+
+    The group exposes a timerfd that becomes readable when a conversion
+    of one of its devices should be complete, so it can be added to an
+    epoll/poll/select set next to network sockets. drain() never sleeps:
+    it collects the finished conversions, starts the next ones and re-arms
+    the timer. Devices of the group convert in parallel, the channels of a
+    device are converted in turn.
+
+    @section license License
+
+    BSD license, all text here must be included in any redistribution
+*/
+/**************************************************************************/
+
+#ifndef ADS1X15_ACQUISITION_H
+#define ADS1X15_ACQUISITION_H
+
+#include <vector>
+
+#include "ADS1X15_SampleBlock.h"
+#include "ADS1X15_TLA2024.h"
+
+class adsDeadband;
+
+/*=========================================================================
+    ACQUISITION SETTINGS
+    -----------------------------------------------------------------------*/
+#define ADS_ACQ_POLL_INTERVAL (50) ///< Re-check delay in uS when a conversion is late
+/*=========================================================================*/
+
+/**************************************************************************/
+/*!
+    @brief  Group of channels acquired through a pollable file descriptor
+*/
+/**************************************************************************/
+class adsAcquisition {
+public:
+    adsAcquisition();
+    ~adsAcquisition();
+    int    addChannel(TLA2024* device, uint8_t input);
+    int    addComparator(ADS1015* device, uint8_t channel, int16_t threshold);
+    int    start(void);
+    void   stop(void);
+    int    fd(void) const;
+    size_t drain(adsSample_t* samples, size_t maxSamples);
+    size_t drain(adsSampleBlock& block);
+    void   addSink(adsSampleSink* sink);
+    void   setFilter(adsDeadband* filter);
+    size_t channelCount(void) const;
+    uint8_t channelInput(uint8_t channel) const;
+    TLA2024* channelDevice(uint8_t channel) const;
+
+private:
+    typedef struct {
+        TLA2024* device;
+        uint8_t  input;
+        bool     comparator;
+        int16_t  threshold;
+    } channel_t;
+
+    typedef struct {
+        TLA2024* device;
+        std::vector<uint8_t> channels; ///< channel indexes converted in turn
+        size_t   next;                 ///< position of the conversion in progress
+        uint64_t deadlineNs;           ///< time the conversion should be complete
+    } device_t;
+
+    device_t* findDevice(TLA2024* device);
+    size_t    collect(adsSample_t* samples, size_t maxSamples, adsDeadband* filter);
+    void      startConversion(device_t* device, uint64_t nowNs);
+    void      armTimer(void);
+
+    std::vector<channel_t> m_channels;
+    std::vector<device_t>  m_devices;
+    std::vector<adsSampleSink*> m_sinks;
+    adsDeadband*           m_filter;  ///< selects the samples drain(samples) returns, NULL for all
+    int                    m_timerFd;
+};
+
+#endif // ADS1X15_ACQUISITION_H
@@ -0,0 +1,470 @@
+/**************************************************************************/
+/*!
+	@file     ADS1X15_BusScheduler.cpp
+
+	Priority-aware arbitration of the I2C transactions of several chips.
+
+	@section license License
+
+	BSD license, all text here must be included in any redistribution
+*/
+/**************************************************************************/
+
+#include <chrono>
+#include <system_error>
+
+#include "ADS1X15_BusScheduler.h"
+
+/**************************************************************************/
+/*!
+	@brief  Instantiates a stopped scheduler
+*/
+/**************************************************************************/
+adsBusScheduler::adsBusScheduler()
+{
+	m_running = false;
+	memset(m_stats, 0, sizeof(m_stats));
+}
+
+/**************************************************************************/
+/*!
+	@brief  Stops the worker, pending reads are dropped
+*/
+/**************************************************************************/
+adsBusScheduler::~adsBusScheduler()
+{
+	stop();
+}
+
+/**************************************************************************/
+/*!
+	@brief  Starts the worker thread
+
+	@return 1 on success, -1 on error
+*/
+/**************************************************************************/
+int adsBusScheduler::start() {
+	std::lock_guard<std::mutex> guard(m_mutex);
+	if (m_running)
+		return 1;
+
+	m_running = true;
+	try {
+		m_worker = std::thread(&adsBusScheduler::run, this);
+	}
+	catch (const std::system_error& error) {
+		fprintf(stderr, "Error while starting the bus scheduler! Error: %s\n", error.what());
+		m_running = false;
+		return -1;
+	}
+
+	return 1;
+}
+
+/**************************************************************************/
+/*!
+	@brief  Stops the worker thread.  Pending reads are dropped, blocking
+			reads in progress return 0.
+*/
+/**************************************************************************/
+void adsBusScheduler::stop() {
+	{
+		std::lock_guard<std::mutex> guard(m_mutex);
+		if (!m_running)
+			return;
+		m_running = false;
+	}
+	m_wakeup.notify_one();
+	m_worker.join();
+
+	std::lock_guard<std::mutex> guard(m_mutex);
+	for (size_t i = 0; i < m_jobs.size(); i++)
+	{
+		if (m_jobs[i]->owned) {
+			delete m_jobs[i];
+		}
+		else {
+			m_jobs[i]->value = 0;
+			m_jobs[i]->done = true;
+		}
+	}
+	m_jobs.clear();
+	m_devices.clear();
+	m_completed.notify_all();
+}
+
+/**************************************************************************/
+/*!
+	@brief  Queues a job, the lock must be held
+
+	@return 1 on success, -1 if the scheduler is not started
+*/
+/**************************************************************************/
+int adsBusScheduler::enqueue(job_t* job) {
+	if (!m_running) {
+		fprintf(stderr, "Error while queuing a read! The bus scheduler is not started\n");
+		return -1;
+	}
+
+	job->done = false;
+	job->value = 0;
+	job->submitNs = adsTimestampNs();
+	job->firstStepNs = 0;
+	job->readyNs = 0;
+	m_jobs.push_back(job);
+	m_wakeup.notify_one();
+	return 1;
+}
+
+/**************************************************************************/
+/*!
+	@brief  Queues a single-shot conversion
+
+	@param device device to convert on, must outlive the scheduler
+	@param input ADS_INPUT_* multiplexer setting
+	@param priority ADS_BUS_PRIORITY_* class
+	@param sink stage fed with the result from the worker thread, may be NULL
+
+	@return 1 on success, -1 on error
+*/
+/**************************************************************************/
+int adsBusScheduler::submit(TLA2024* device, uint8_t input, uint8_t priority, adsSampleSink* sink) {
+	if (!device || input >= ADS_INPUT_COUNT || priority >= ADS_BUS_PRIORITY_COUNT)
+		return -1;
+
+	job_t* job = new job_t;
+	job->device = device;
+	job->input = input;
+	job->priority = priority;
+	job->state = JOB_QUEUED;
+	job->sink = sink;
+	job->owned = true;
+
+	std::lock_guard<std::mutex> guard(m_mutex);
+	if (enqueue(job) < 0) {
+		delete job;
+		return -1;
+	}
+
+	return 1;
+}
+
+/**************************************************************************/
+/*!
+	@brief  Queues a read of the last result without a new conversion,
+			e.g. a comparator channel after an alert (it also clears a
+			latched ALERT/RDY pin)
+
+	@param device device to read, must outlive the scheduler
+	@param priority ADS_BUS_PRIORITY_* class
+	@param sink stage fed with the result from the worker thread (channel
+			and input 0), may be NULL
+
+	@return 1 on success, -1 on error
+*/
+/**************************************************************************/
+int adsBusScheduler::submitLast(TLA2024* device, uint8_t priority, adsSampleSink* sink) {
+	if (!device || priority >= ADS_BUS_PRIORITY_COUNT)
+		return -1;
+
+	job_t* job = new job_t;
+	job->device = device;
+	job->input = ADS_INPUT_COUNT;
+	job->priority = priority;
+	job->state = JOB_LAST;
+	job->sink = sink;
+	job->owned = true;
+
+	std::lock_guard<std::mutex> guard(m_mutex);
+	if (enqueue(job) < 0) {
+		delete job;
+		return -1;
+	}
+
+	return 1;
+}
+
+/**************************************************************************/
+/*!
+	@brief  Converts an input and waits for the result
+
+	@param device device to convert on
+	@param input ADS_INPUT_* multiplexer setting
+	@param priority ADS_BUS_PRIORITY_* class
+
+	@return the ADC reading, 0 on error
+*/
+/**************************************************************************/
+int16_t adsBusScheduler::read(TLA2024* device, uint8_t input, uint8_t priority) {
+	if (!device || input >= ADS_INPUT_COUNT || priority >= ADS_BUS_PRIORITY_COUNT)
+		return 0;
+
+	job_t job;
+	job.device = device;
+	job.input = input;
+	job.priority = priority;
+	job.state = JOB_QUEUED;
+	job.sink = NULL;
+	job.owned = false;
+
+	std::unique_lock<std::mutex> lock(m_mutex);
+	if (enqueue(&job) < 0)
+		return 0;
+
+	m_completed.wait(lock, [&job] { return job.done; });
+	return job.value;
+}
+
+/**************************************************************************/
+/*!
+	@brief  Reads the last result without a new conversion and waits for
+			it, see submitLast()
+
+	@param device device to read
+	@param priority ADS_BUS_PRIORITY_* class
+
+	@return the ADC reading, 0 on error
+*/
+/**************************************************************************/
+int16_t adsBusScheduler::readLast(TLA2024* device, uint8_t priority) {
+	if (!device || priority >= ADS_BUS_PRIORITY_COUNT)
+		return 0;
+
+	job_t job;
+	job.device = device;
+	job.input = ADS_INPUT_COUNT;
+	job.priority = priority;
+	job.state = JOB_LAST;
+	job.sink = NULL;
+	job.owned = false;
+
+	std::unique_lock<std::mutex> lock(m_mutex);
+	if (enqueue(&job) < 0)
+		return 0;
+
+	m_completed.wait(lock, [&job] { return job.done; });
+	return job.value;
+}
+
+/**************************************************************************/
+/*!
+	@brief  Gets the number of queued or running reads
+*/
+/**************************************************************************/
+size_t adsBusScheduler::pending() {
+	std::lock_guard<std::mutex> guard(m_mutex);
+	return m_jobs.size();
+}
+
+/**************************************************************************/
+/*!
+	@brief  Gets the latency statistics of a priority class
+*/
+/**************************************************************************/
+adsBusStats_t adsBusScheduler::stats(uint8_t priority) {
+	std::lock_guard<std::mutex> guard(m_mutex);
+	return m_stats[priority < ADS_BUS_PRIORITY_COUNT ? priority : ADS_BUS_PRIORITY_BULK];
+}
+
+/**************************************************************************/
+/*!
+	@brief  Clears the statistics of every class
+*/
+/**************************************************************************/
+void adsBusScheduler::resetStats() {
+	std::lock_guard<std::mutex> guard(m_mutex);
+	memset(m_stats, 0, sizeof(m_stats));
+}
+
+/**************************************************************************/
+/*!
+	@brief  Finds or adds the conversion state of a chip
+*/
+/**************************************************************************/
+adsBusScheduler::device_t* adsBusScheduler::findDevice(TLA2024* device) {
+	for (size_t i = 0; i < m_devices.size(); i++)
+		if (m_devices[i].device == device)
+			return &m_devices[i];
+
+	device_t entry;
+	entry.device = device;
+	entry.active = NULL;
+	m_devices.push_back(entry);
+	return &m_devices.back();
+}
+
+/**************************************************************************/
+/*!
+	@brief  Picks the most urgent step that can run now, the oldest job
+			first within a class.  A queued conversion can run when its
+			chip is idle, or once the less urgent conversion in progress
+			is due (the chip ignores a start while converting).
+
+	@param nowNs current time
+	@param wakeNs set to the earliest time a converting job becomes ready
+
+	@return the job, NULL if no step can run now
+*/
+/**************************************************************************/
+adsBusScheduler::job_t* adsBusScheduler::pickJob(uint64_t nowNs, uint64_t* wakeNs) {
+	job_t* best = NULL;
+	for (size_t i = 0; i < m_jobs.size(); i++)
+	{
+		job_t* job = m_jobs[i];
+		if (best && job->priority >= best->priority)
+			continue;
+
+		if (job->state == JOB_CONVERTING && job->readyNs > nowNs) {
+			if (job->readyNs < *wakeNs)
+				*wakeNs = job->readyNs;
+			continue;
+		}
+
+		if (job->state == JOB_QUEUED) {
+			job_t* active = findDevice(job->device)->active;
+			if (active && active->priority <= job->priority)
+				continue;
+			if (active && active->readyNs > nowNs) {
+				if (active->readyNs < *wakeNs)
+					*wakeNs = active->readyNs;
+				continue;
+			}
+		}
+
+		best = job;
+	}
+
+	return best;
+}
+
+/**************************************************************************/
+/*!
+	@brief  Runs the next bus step of a job, the lock is released during
+			the transaction
+*/
+/**************************************************************************/
+void adsBusScheduler::runStep(job_t* job, std::unique_lock<std::mutex>& lock) {
+	if (!job->firstStepNs) {
+		job->firstStepNs = adsTimestampNs();
+		uint64_t wait = job->firstStepNs - job->submitNs;
+		if (wait > m_stats[job->priority].maxWaitNs)
+			m_stats[job->priority].maxWaitNs = wait;
+	}
+
+	if (job->state == JOB_LAST) {
+		lock.unlock();
+		int16_t value = job->device->readConversionResult();
+		lock.lock();
+		finish(job, value, lock);
+		return;
+	}
+
+	device_t* device = findDevice(job->device);
+	if (job->state == JOB_QUEUED) {
+		// OS=1 is ignored during a single-shot conversion: the new one
+		// only starts once the conversion in progress is complete
+		if (device->active && device->active != job) {
+			lock.unlock();
+			bool idle = job->device->isConversionReady();
+			lock.lock();
+			if (!idle) {
+				device->active->readyNs = adsTimestampNs() + ADS_BUS_POLL_INTERVAL * 1000;
+				return;
+			}
+
+			// Its result is discarded, it converts again afterwards
+			device->active->state = JOB_QUEUED;
+			m_stats[device->active->priority].preempted++;
+		}
+		device->active = job;
+		job->state = JOB_CONVERTING;
+
+		lock.unlock();
+		job->device->startADC_Input(job->input);
+		lock.lock();
+		job->readyNs = adsTimestampNs() + (uint64_t)job->device->getConversionDelay() * 1000;
+		return;
+	}
+
+	lock.unlock();
+	bool ready = job->device->isConversionReady();
+	int16_t value = ready ? job->device->readConversionResult() : 0;
+	lock.lock();
+
+	if (!ready) {
+		job->readyNs = adsTimestampNs() + ADS_BUS_POLL_INTERVAL * 1000;
+		return;
+	}
+
+	device->active = NULL;
+	finish(job, value, lock);
+}
+
+/**************************************************************************/
+/*!
+	@brief  Completes a job: statistics, sink or blocked caller
+*/
+/**************************************************************************/
+void adsBusScheduler::finish(job_t* job, int16_t value, std::unique_lock<std::mutex>& lock) {
+	uint64_t now = adsTimestampNs();
+	adsBusStats_t* stats = &m_stats[job->priority];
+	uint64_t latency = now - job->submitNs;
+	stats->completed++;
+	stats->totalLatencyNs += latency;
+	if (latency > stats->maxLatencyNs)
+		stats->maxLatencyNs = latency;
+
+	for (size_t i = 0; i < m_jobs.size(); i++)
+	{
+		if (m_jobs[i] == job) {
+			m_jobs.erase(m_jobs.begin() + i);
+			break;
+		}
+	}
+
+	if (!job->owned) {
+		job->value = value;
+		job->done = true;
+		m_completed.notify_all();
+		return;
+	}
+
+	if (job->sink) {
+		adsSample_t sample;
+		sample.timestampNs = now;
+		sample.value = value;
+		sample.channel = job->state == JOB_LAST ? 0 : job->input;
+		sample.input = job->state == JOB_LAST ? 0 : job->input;
+		sample.alert = 0;
+
+		lock.unlock();
+		job->sink->onSample(sample);
+		lock.lock();
+	}
+	delete job;
+}
+
+/**************************************************************************/
+/*!
+	@brief  Worker thread: runs one step at a time, sleeping while every
+			job waits for its conversion
+*/
+/**************************************************************************/
+void adsBusScheduler::run() {
+	std::unique_lock<std::mutex> lock(m_mutex);
+	while (m_running)
+	{
+		uint64_t now = adsTimestampNs();
+		uint64_t wake = UINT64_MAX;
+		job_t* job = pickJob(now, &wake);
+		if (job) {
+			runStep(job, lock);
+			continue;
+		}
+
+		if (wake == UINT64_MAX)
+			m_wakeup.wait(lock);
+		else
+			m_wakeup.wait_for(lock, std::chrono::nanoseconds(wake - now));
+	}
+}
@@ -0,0 +1,126 @@
+/**************************************************************************/
+/*!
+    @file     ADS1X15_BusScheduler.h
+
+    Priority-aware arbitration of the I2C transactions of several chips.
+
+    A single worker thread owns the bus. Every read is queued with a
+    priority class and split into its bus steps (start the conversion,
+    poll the OS bit and read the result); between two steps the worker
+    always runs the most urgent step that is ready. While a bulk
+    conversion waits for its conversion delay, urgent reads of other
+    chips go through. The chip ignores a start while a single-shot
+    conversion runs, so an urgent conversion on the same chip takes over
+    once the bulk conversion is complete, and the bulk conversion is
+    restarted afterwards.
+
+    An urgent read therefore waits for at most one bus transaction of a
+    lower class before its own steps, plus up to one conversion time if
+    its chip is busy with a lower class, instead of a whole scan cycle.
+
+    Once started, every transaction of the scheduled devices must go
+    through the scheduler. Sinks are called from the worker thread and
+    must not call the blocking reads.
+
+    @section license License
+
+    BSD license, all text here must be included in any redistribution
+*/
+/**************************************************************************/
+
+#ifndef ADS1X15_BUSSCHEDULER_H
+#define ADS1X15_BUSSCHEDULER_H
+
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "ADS1X15_TLA2024.h"
+
+/*=========================================================================
+    BUS SCHEDULER SETTINGS
+    -----------------------------------------------------------------------*/
+#define ADS_BUS_PRIORITY_URGENT (0)  ///< Alarm and limit reads
+#define ADS_BUS_PRIORITY_NORMAL (1)  ///< Regular reads
+#define ADS_BUS_PRIORITY_BULK   (2)  ///< Background scans
+#define ADS_BUS_PRIORITY_COUNT  (3)  ///< Number of priority classes
+#define ADS_BUS_POLL_INTERVAL   (50) ///< OS bit poll interval in uS once the conversion delay expired
+/*=========================================================================*/
+
+/** Latency statistics of one priority class */
+typedef struct {
+    uint64_t completed;      ///< reads completed
+    uint64_t preempted;      ///< conversions restarted after a more urgent one took the chip
+    uint64_t totalLatencyNs; ///< sum of the submit to result times
+    uint64_t maxLatencyNs;   ///< worst submit to result time
+    uint64_t maxWaitNs;      ///< worst submit to first bus transaction time
+} adsBusStats_t;
+
+/**************************************************************************/
+/*!
+    @brief  Single bus owner running reads by priority class
+*/
+/**************************************************************************/
+class adsBusScheduler {
+public:
+    adsBusScheduler();
+    ~adsBusScheduler();
+    int     start(void);
+    void    stop(void);
+    int     submit(TLA2024* device, uint8_t input, uint8_t priority, adsSampleSink* sink);
+    int     submitLast(TLA2024* device, uint8_t priority, adsSampleSink* sink);
+    int16_t read(TLA2024* device, uint8_t input, uint8_t priority);
+    int16_t readLast(TLA2024* device, uint8_t priority);
+    size_t  pending(void);
+    adsBusStats_t stats(uint8_t priority);
+    void    resetStats(void);
+
+private:
+    /** Bus steps of a read */
+    typedef enum {
+        JOB_QUEUED,     ///< conversion not started (or restarted)
+        JOB_CONVERTING, ///< conversion started, result due at readyNs
+        JOB_LAST        ///< read of the last result, single step
+    } jobState_t;
+
+    typedef struct {
+        TLA2024*       device;
+        uint8_t        input;
+        uint8_t        priority;
+        jobState_t     state;
+        adsSampleSink* sink;
+        bool           owned;     ///< allocated by submit(), deleted when done
+        bool           done;
+        int16_t        value;
+        uint64_t       submitNs;
+        uint64_t       firstStepNs;
+        uint64_t       readyNs;
+    } job_t;
+
+    /** Conversion in progress on a chip */
+    typedef struct {
+        TLA2024* device;
+        job_t*   active;
+    } device_t;
+
+    adsBusScheduler(const adsBusScheduler&);
+    adsBusScheduler& operator=(const adsBusScheduler&);
+    int       enqueue(job_t* job);
+    void      run(void);
+    job_t*    pickJob(uint64_t nowNs, uint64_t* wakeNs);
+    device_t* findDevice(TLA2024* device);
+    void      runStep(job_t* job, std::unique_lock<std::mutex>& lock);
+    void      finish(job_t* job, int16_t value, std::unique_lock<std::mutex>& lock);
+
+    std::mutex              m_mutex;
+    std::condition_variable m_wakeup;     ///< worker: new job or stop
+    std::condition_variable m_completed;  ///< blocking reads
+    std::thread             m_worker;
+    bool                    m_running;
+    std::vector<job_t*>     m_jobs;       ///< in submit order
+    std::vector<device_t>   m_devices;    ///< worker only
+    adsBusStats_t           m_stats[ADS_BUS_PRIORITY_COUNT];
+};
+
+#endif // ADS1X15_BUSSCHEDULER_H
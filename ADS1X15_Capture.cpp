@@ -0,0 +1,245 @@
+/**************************************************************************/
+/*!
+	@file     ADS1X15_Capture.cpp
+
+	Pre/post-trigger burst capture on the acquisition path.
+
+	@section license License
+
+	BSD license, all text here must be included in any redistribution
+*/
+/**************************************************************************/
+
+#include "ADS1X15_Capture.h"
+
+/**************************************************************************/
+/*!
+	@brief  Instantiates an armed capture with the software trigger only
+
+	@param preSamples samples kept before the trigger
+	@param postSamples samples recorded from the trigger on, at least 1
+*/
+/**************************************************************************/
+adsCapture::adsCapture(size_t preSamples, size_t postSamples)
+{
+	m_pre = preSamples;
+	m_post = postSamples ? postSamples : 1;
+	for (size_t i = 0; i < 2; i++)
+	{
+		m_buffers[i].samples.resize(m_pre + m_post);
+		m_buffers[i].head = 0;
+		m_buffers[i].count = 0;
+		m_buffers[i].preCount = 0;
+		m_buffers[i].triggerNs = 0;
+		m_buffers[i].source = 0;
+	}
+	m_active = 0;
+	m_frozen = 1;
+	m_remaining = 0;
+	m_previous.assign(UINT8_MAX + 1, 0);
+	m_seen.assign(UINT8_MAX + 1, 0);
+	m_softwareTrigger = false;
+	m_snapshot = SNAPSHOT_NONE;
+	m_triggered = false;
+	m_triggers = 0;
+	m_snapshots = 0;
+	m_dropped = 0;
+	setTrigger(ADS_CAPTURE_TRIGGER_SOFTWARE);
+}
+
+/**************************************************************************/
+/*!
+	@brief  Selects the trigger sources, before the samples are fed
+
+	@param sources ADS_CAPTURE_TRIGGER_* flags, the software trigger is
+			always enabled
+	@param channel channel the level and alert are checked on, or
+			ADS_CAPTURE_ALL_CHANNELS
+	@param level code the rising and falling edges cross
+*/
+/**************************************************************************/
+void adsCapture::setTrigger(uint8_t sources, int channel, int16_t level) {
+	m_sources = sources | ADS_CAPTURE_TRIGGER_SOFTWARE;
+	m_channel = channel;
+	m_level = level;
+	m_seen.assign(m_seen.size(), 0);
+}
+
+/**************************************************************************/
+/*!
+	@brief  Triggers a burst on the next sample, from any thread.  Dropped
+			if a burst is being recorded, it does not start another one
+			afterwards.
+*/
+/**************************************************************************/
+void adsCapture::trigger() {
+	m_softwareTrigger.store(true, std::memory_order_release);
+}
+
+/**************************************************************************/
+/*!
+	@brief  Checks the level crossing and alert of a sample, remembering
+			its value for the next crossing
+
+	@return the ADS_CAPTURE_TRIGGER_* source that fired, 0 if none
+*/
+/**************************************************************************/
+uint8_t adsCapture::checkLevel(const adsSample_t& sample) {
+	if (m_channel != ADS_CAPTURE_ALL_CHANNELS && sample.channel != m_channel)
+		return 0;
+
+	uint8_t source = 0;
+	if ((m_sources & ADS_CAPTURE_TRIGGER_ALERT) && sample.alert)
+		source = ADS_CAPTURE_TRIGGER_ALERT;
+
+	if (m_seen[sample.channel]) {
+		int16_t previous = m_previous[sample.channel];
+		if ((m_sources & ADS_CAPTURE_TRIGGER_RISING) && previous < m_level && sample.value >= m_level)
+			source = ADS_CAPTURE_TRIGGER_RISING;
+		if ((m_sources & ADS_CAPTURE_TRIGGER_FALLING) && previous > m_level && sample.value <= m_level)
+			source = ADS_CAPTURE_TRIGGER_FALLING;
+	}
+
+	m_previous[sample.channel] = sample.value;
+	m_seen[sample.channel] = 1;
+	return source;
+}
+
+/**************************************************************************/
+/*!
+	@brief  Records a sample, starts a burst on a trigger and freezes it
+			once the post-trigger samples are in
+*/
+/**************************************************************************/
+void adsCapture::onSample(const adsSample_t& sample) {
+	buffer_t* buffer = &m_buffers[m_active];
+	size_t capacity = buffer->samples.size();
+	buffer->samples[buffer->head] = sample;
+	buffer->head = buffer->head + 1 < capacity ? buffer->head + 1 : 0;
+	if (buffer->count < capacity)
+		buffer->count++;
+
+	uint8_t source = checkLevel(sample);
+	if (m_remaining) {
+		// Triggers during a burst are dropped, not deferred
+		if (m_softwareTrigger.load(std::memory_order_relaxed))
+			m_softwareTrigger.store(false, std::memory_order_relaxed);
+	}
+	else {
+		if (m_softwareTrigger.load(std::memory_order_acquire) && m_softwareTrigger.exchange(false))
+			source = ADS_CAPTURE_TRIGGER_SOFTWARE;
+		if (!source)
+			return;
+
+		// The trigger sample is the first post-trigger sample
+		buffer->preCount = buffer->count - 1 < m_pre ? buffer->count - 1 : m_pre;
+		buffer->triggerNs = sample.timestampNs;
+		buffer->source = source;
+		m_remaining = m_post;
+		m_triggers++;
+		m_triggered = true;
+	}
+
+	if (--m_remaining == 0)
+		freeze();
+}
+
+/**************************************************************************/
+/*!
+	@brief  Publishes the recorded buffer as the snapshot and records into
+			the other one, or drops the burst if the other one is in use
+*/
+/**************************************************************************/
+void adsCapture::freeze() {
+	m_triggered = false;
+	if (m_snapshot.load(std::memory_order_acquire) != SNAPSHOT_NONE) {
+		m_dropped++;
+		return;
+	}
+
+	m_frozen = m_active;
+	m_snapshots++;
+	m_snapshot.store(SNAPSHOT_READY, std::memory_order_release);
+
+	m_active ^= 1;
+	m_buffers[m_active].head = 0;
+	m_buffers[m_active].count = 0;
+}
+
+/**************************************************************************/
+/*!
+	@brief  Takes the last frozen burst, the samples stay valid until
+			releaseSnapshot()
+
+	@param snapshot filled with the two parts of the ring
+
+	@return true if a burst was ready
+*/
+/**************************************************************************/
+bool adsCapture::takeSnapshot(adsCaptureSnapshot_t* snapshot) {
+	int expected = SNAPSHOT_READY;
+	if (!snapshot || !m_snapshot.compare_exchange_strong(expected, SNAPSHOT_HELD, std::memory_order_acq_rel))
+		return false;
+
+	const buffer_t* buffer = &m_buffers[m_frozen];
+	size_t capacity = buffer->samples.size();
+	size_t total = buffer->preCount + m_post;
+	size_t start = (buffer->head + capacity - total) % capacity;
+
+	snapshot->first = &buffer->samples[start];
+	snapshot->firstCount = capacity - start < total ? capacity - start : total;
+	snapshot->secondCount = total - snapshot->firstCount;
+	snapshot->second = snapshot->secondCount ? &buffer->samples[0] : NULL;
+	snapshot->preCount = buffer->preCount;
+	snapshot->triggerNs = buffer->triggerNs;
+	snapshot->source = buffer->source;
+
+	return true;
+}
+
+/**************************************************************************/
+/*!
+	@brief  Gives the snapshot buffer back for the next burst
+*/
+/**************************************************************************/
+void adsCapture::releaseSnapshot() {
+	int expected = SNAPSHOT_HELD;
+	m_snapshot.compare_exchange_strong(expected, SNAPSHOT_NONE, std::memory_order_acq_rel);
+}
+
+/**************************************************************************/
+/*!
+	@brief  Checks if a burst is being recorded
+*/
+/**************************************************************************/
+bool adsCapture::isTriggered() const {
+	return m_triggered;
+}
+
+/**************************************************************************/
+/*!
+	@brief  Gets the number of events that started a burst
+*/
+/**************************************************************************/
+uint64_t adsCapture::triggers() const {
+	return m_triggers;
+}
+
+/**************************************************************************/
+/*!
+	@brief  Gets the number of bursts frozen
+*/
+/**************************************************************************/
+uint64_t adsCapture::snapshots() const {
+	return m_snapshots;
+}
+
+/**************************************************************************/
+/*!
+	@brief  Gets the number of bursts lost because the previous snapshot
+			was not released
+*/
+/**************************************************************************/
+uint64_t adsCapture::dropped() const {
+	return m_dropped;
+}
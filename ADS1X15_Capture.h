@@ -0,0 +1,116 @@
+/**************************************************************************/
+/*!
+    @file     ADS1X15_Capture.h
+
+    Pre/post-trigger burst capture on the acquisition path.
+
+    The capture stage records every sample it is fed into a circular
+    history of pre + post samples. A trigger (software, threshold crossing
+    or comparator alert) starts the post-trigger count; once the post
+    samples are in, the history holds exactly the burst around the event
+    and is frozen as the snapshot: the stage swaps to its second buffer
+    and keeps recording, nothing is copied.
+
+    The snapshot is handed over without a lock: takeSnapshot() gives the
+    two contiguous parts of the frozen ring, releaseSnapshot() returns the
+    buffer. Bursts completing while the previous snapshot is not released
+    are counted as dropped. After a swap the pre-trigger history builds up again, a
+    burst triggered earlier has fewer pre-trigger samples.
+
+    The stage can be fed from adsAcquisition, adsRateScheduler or a
+    TLA2024 sink; trigger() may be called from any thread.
+
+    @section license License
+
+    BSD license, all text here must be included in any redistribution
+*/
+/**************************************************************************/
+
+#ifndef ADS1X15_CAPTURE_H
+#define ADS1X15_CAPTURE_H
+
+#include <atomic>
+#include <vector>
+
+#include "ADS1X15_TLA2024.h"
+
+/*=========================================================================
+    TRIGGER SOURCES
+    -----------------------------------------------------------------------*/
+#define ADS_CAPTURE_TRIGGER_SOFTWARE (0x01) ///< trigger() calls, always enabled
+#define ADS_CAPTURE_TRIGGER_RISING   (0x02) ///< value crosses the level upwards
+#define ADS_CAPTURE_TRIGGER_FALLING  (0x04) ///< value crosses the level downwards
+#define ADS_CAPTURE_TRIGGER_ALERT    (0x08) ///< comparator alert of the sample (ALERT/RDY pin)
+#define ADS_CAPTURE_ALL_CHANNELS     (-1)   ///< threshold and alert on every channel (any uint8_t is a channel)
+/*=========================================================================*/
+
+/** Frozen burst: the ring in two contiguous parts, oldest sample first */
+typedef struct {
+    const adsSample_t* first;       ///< oldest samples
+    size_t             firstCount;
+    const adsSample_t* second;      ///< samples after the ring wrapped, may be NULL
+    size_t             secondCount;
+    size_t             preCount;    ///< samples before the trigger, the trigger sample is the next one
+    uint64_t           triggerNs;   ///< timestamp of the trigger sample
+    uint8_t            source;      ///< ADS_CAPTURE_TRIGGER_* that fired
+} adsCaptureSnapshot_t;
+
+/**************************************************************************/
+/*!
+    @brief  Circular history frozen around trigger events
+*/
+/**************************************************************************/
+class adsCapture : public adsSampleSink {
+public:
+    adsCapture(size_t preSamples, size_t postSamples);
+    void     setTrigger(uint8_t sources, int channel = ADS_CAPTURE_ALL_CHANNELS, int16_t level = 0);
+    void     trigger(void);
+    void     onSample(const adsSample_t& sample);
+    bool     takeSnapshot(adsCaptureSnapshot_t* snapshot);
+    void     releaseSnapshot(void);
+    bool     isTriggered(void) const;
+    uint64_t triggers(void) const;
+    uint64_t snapshots(void) const;
+    uint64_t dropped(void) const;
+
+private:
+    typedef struct {
+        std::vector<adsSample_t> samples;
+        size_t   head;       ///< next position written
+        size_t   count;      ///< valid samples, up to the capacity
+        size_t   preCount;
+        uint64_t triggerNs;
+        uint8_t  source;
+    } buffer_t;
+
+    enum {
+        SNAPSHOT_NONE,   ///< the other buffer is free
+        SNAPSHOT_READY,  ///< the other buffer holds a burst
+        SNAPSHOT_HELD    ///< the reader uses the other buffer
+    };
+
+    adsCapture(const adsCapture&);
+    adsCapture& operator=(const adsCapture&);
+    uint8_t checkLevel(const adsSample_t& sample);
+    void    freeze(void);
+
+    buffer_t              m_buffers[2];
+    size_t                m_active;     ///< buffer recorded by onSample()
+    size_t                m_frozen;     ///< buffer of the snapshot, published by m_snapshot
+    size_t                m_pre;
+    size_t                m_post;
+    size_t                m_remaining;  ///< post samples still to record, 0 while armed
+    uint8_t               m_sources;
+    int                   m_channel;    ///< sample channel, or ADS_CAPTURE_ALL_CHANNELS
+    int16_t               m_level;
+    std::vector<int16_t>  m_previous;   ///< last value per channel, for the crossings
+    std::vector<uint8_t>  m_seen;       ///< the channel has a previous value
+    std::atomic<bool>     m_softwareTrigger;
+    std::atomic<int>      m_snapshot;   ///< SNAPSHOT_* state of the other buffer
+    std::atomic<bool>     m_triggered;
+    std::atomic<uint64_t> m_triggers;   ///< events that started a burst
+    std::atomic<uint64_t> m_snapshots;  ///< bursts frozen
+    std::atomic<uint64_t> m_dropped;    ///< bursts lost while a snapshot was pending
+};
+
+#endif // ADS1X15_CAPTURE_H
@@ -0,0 +1,585 @@
+/**************************************************************************/
+/*!
+	@file     ADS1X15_Codec.cpp
+
+	Compact encoding of sample columns and blocks for storage and
+	telemetry.
+
+	@section license License
+
+	BSD license, all text here must be included in any redistribution
+*/
+/**************************************************************************/
+
+#include "ADS1X15_Codec.h"
+
+// Define ADS_CODEC_SCALAR to build the portable kernel only
+#if !defined(ADS_CODEC_SCALAR) && defined(__SSE2__)
+#include <emmintrin.h>
+#define ADS_CODEC_SSE2
+#elif !defined(ADS_CODEC_SCALAR) && defined(__ARM_NEON)
+#include <arm_neon.h>
+#define ADS_CODEC_NEON
+#endif
+
+#define ADS_CODEC_LANES   (8)                              ///< 16-bit lanes per vector
+#define ADS_CODEC_VECTORS (ADS_CODEC_GROUP / ADS_CODEC_LANES) ///< vectors per group
+
+/*=========================================================================
+    VECTOR PRIMITIVES (8 x 16 bits)
+    -----------------------------------------------------------------------*/
+#if defined(ADS_CODEC_SSE2)
+typedef __m128i vec_t;
+static inline vec_t vload(const void* p) { return _mm_loadu_si128((const __m128i*)p); }
+static inline void  vstore(void* p, vec_t v) { _mm_storeu_si128((__m128i*)p, v); }
+static inline vec_t vzero(void) { return _mm_setzero_si128(); }
+static inline vec_t vset1(uint16_t x) { return _mm_set1_epi16((short)x); }
+static inline vec_t vor(vec_t a, vec_t b) { return _mm_or_si128(a, b); }
+static inline vec_t vand(vec_t a, vec_t b) { return _mm_and_si128(a, b); }
+static inline vec_t vxor(vec_t a, vec_t b) { return _mm_xor_si128(a, b); }
+static inline vec_t vadd(vec_t a, vec_t b) { return _mm_add_epi16(a, b); }
+static inline vec_t vsub(vec_t a, vec_t b) { return _mm_sub_epi16(a, b); }
+static inline vec_t vsll(vec_t v, int n) { return _mm_sll_epi16(v, _mm_cvtsi32_si128(n)); }
+static inline vec_t vsrl(vec_t v, int n) { return _mm_srl_epi16(v, _mm_cvtsi32_si128(n)); }
+static inline vec_t vsll1(vec_t v) { return _mm_slli_epi16(v, 1); }
+static inline vec_t vsrl1(vec_t v) { return _mm_srli_epi16(v, 1); }
+static inline vec_t vsign(vec_t v) { return _mm_srai_epi16(v, 15); }
+static inline uint16_t vlast(vec_t v) { return (uint16_t)_mm_extract_epi16(v, 7); }
+
+/// Inclusive prefix sum of the lanes plus a carry
+static inline vec_t vprefix(vec_t v, uint16_t carry) {
+	v = _mm_add_epi16(v, _mm_slli_si128(v, 2));
+	v = _mm_add_epi16(v, _mm_slli_si128(v, 4));
+	v = _mm_add_epi16(v, _mm_slli_si128(v, 8));
+	return _mm_add_epi16(v, _mm_set1_epi16((short)carry));
+}
+
+/// OR of the lanes
+static inline uint16_t vhor(vec_t v) {
+	v = _mm_or_si128(v, _mm_srli_si128(v, 8));
+	v = _mm_or_si128(v, _mm_srli_si128(v, 4));
+	v = _mm_or_si128(v, _mm_srli_si128(v, 2));
+	return (uint16_t)_mm_cvtsi128_si32(v);
+}
+#elif defined(ADS_CODEC_NEON)
+typedef uint16x8_t vec_t;
+static inline vec_t vload(const void* p) { return vld1q_u16((const uint16_t*)p); }
+static inline void  vstore(void* p, vec_t v) { vst1q_u16((uint16_t*)p, v); }
+static inline vec_t vzero(void) { return vdupq_n_u16(0); }
+static inline vec_t vset1(uint16_t x) { return vdupq_n_u16(x); }
+static inline vec_t vor(vec_t a, vec_t b) { return vorrq_u16(a, b); }
+static inline vec_t vand(vec_t a, vec_t b) { return vandq_u16(a, b); }
+static inline vec_t vxor(vec_t a, vec_t b) { return veorq_u16(a, b); }
+static inline vec_t vadd(vec_t a, vec_t b) { return vaddq_u16(a, b); }
+static inline vec_t vsub(vec_t a, vec_t b) { return vsubq_u16(a, b); }
+static inline vec_t vsll(vec_t v, int n) { return n >= 16 ? vzero() : vshlq_u16(v, vdupq_n_s16((int16_t)n)); }
+static inline vec_t vsrl(vec_t v, int n) { return n >= 16 ? vzero() : vshlq_u16(v, vdupq_n_s16((int16_t)-n)); }
+static inline vec_t vsll1(vec_t v) { return vshlq_n_u16(v, 1); }
+static inline vec_t vsrl1(vec_t v) { return vshrq_n_u16(v, 1); }
+static inline vec_t vsign(vec_t v) { return vreinterpretq_u16_s16(vshrq_n_s16(vreinterpretq_s16_u16(v), 15)); }
+static inline uint16_t vlast(vec_t v) { return vgetq_lane_u16(v, 7); }
+
+static inline vec_t vprefix(vec_t v, uint16_t carry) {
+	vec_t zero = vdupq_n_u16(0);
+	v = vaddq_u16(v, vextq_u16(zero, v, 7));
+	v = vaddq_u16(v, vextq_u16(zero, v, 6));
+	v = vaddq_u16(v, vextq_u16(zero, v, 4));
+	return vaddq_u16(v, vdupq_n_u16(carry));
+}
+
+static inline uint16_t vhor(vec_t v) {
+	uint16x4_t h = vorr_u16(vget_low_u16(v), vget_high_u16(v));
+	h = vorr_u16(h, vext_u16(h, h, 2));
+	h = vorr_u16(h, vext_u16(h, h, 1));
+	return vget_lane_u16(h, 0);
+}
+#else
+typedef struct { uint16_t lane[ADS_CODEC_LANES]; } vec_t;
+static inline vec_t vload(const void* p) { vec_t v; memcpy(v.lane, p, sizeof(v.lane)); return v; }
+static inline void  vstore(void* p, vec_t v) { memcpy(p, v.lane, sizeof(v.lane)); }
+static inline vec_t vset1(uint16_t x) { vec_t v; for (int i = 0; i < ADS_CODEC_LANES; i++) v.lane[i] = x; return v; }
+static inline vec_t vzero(void) { return vset1(0); }
+#define ADS_CODEC_LANEWISE(name, expr)                                           \
+	static inline vec_t name(vec_t a, vec_t b) {                                 \
+		vec_t r;                                                                 \
+		for (int i = 0; i < ADS_CODEC_LANES; i++)                                \
+			r.lane[i] = (uint16_t)(expr);                                        \
+		(void)b;                                                                 \
+		return r;                                                                \
+	}
+ADS_CODEC_LANEWISE(vor, a.lane[i] | b.lane[i])
+ADS_CODEC_LANEWISE(vand, a.lane[i] & b.lane[i])
+ADS_CODEC_LANEWISE(vxor, a.lane[i] ^ b.lane[i])
+ADS_CODEC_LANEWISE(vadd, a.lane[i] + b.lane[i])
+ADS_CODEC_LANEWISE(vsub, a.lane[i] - b.lane[i])
+static inline vec_t vsll(vec_t v, int n) { for (int i = 0; i < ADS_CODEC_LANES; i++) v.lane[i] = n >= 16 ? 0 : (uint16_t)(v.lane[i] << n); return v; }
+static inline vec_t vsrl(vec_t v, int n) { for (int i = 0; i < ADS_CODEC_LANES; i++) v.lane[i] = n >= 16 ? 0 : (uint16_t)(v.lane[i] >> n); return v; }
+static inline vec_t vsll1(vec_t v) { return vsll(v, 1); }
+static inline vec_t vsrl1(vec_t v) { return vsrl(v, 1); }
+static inline vec_t vsign(vec_t v) { for (int i = 0; i < ADS_CODEC_LANES; i++) v.lane[i] = (v.lane[i] & 0x8000) ? 0xFFFF : 0; return v; }
+static inline uint16_t vlast(vec_t v) { return v.lane[ADS_CODEC_LANES - 1]; }
+
+static inline vec_t vprefix(vec_t v, uint16_t carry) {
+	for (int i = 0; i < ADS_CODEC_LANES; i++)
+		carry = v.lane[i] = (uint16_t)(v.lane[i] + carry);
+	return v;
+}
+
+static inline uint16_t vhor(vec_t v) {
+	uint16_t x = 0;
+	for (int i = 0; i < ADS_CODEC_LANES; i++)
+		x |= v.lane[i];
+	return x;
+}
+#endif
+/*=========================================================================*/
+
+/**************************************************************************/
+/*!
+	@brief  Maps a group of codes to zigzag values and gets their width
+
+	@param codes ADS_CODEC_GROUP codes, codes[-1] is the previous code
+	@param mode ADS_CODEC_DELTA or ADS_CODEC_ZIGZAG
+	@param zigzag output values
+
+	@return the bit width of the largest value, 0 to 16
+*/
+/**************************************************************************/
+static uint8_t encodeGroup(const int16_t* codes, uint8_t mode, uint16_t* zigzag) {
+	vec_t any = vzero();
+	for (int i = 0; i < ADS_CODEC_VECTORS; i++)
+	{
+		vec_t value = vload(codes + i * ADS_CODEC_LANES);
+		if (mode == ADS_CODEC_DELTA)
+			value = vsub(value, vload(codes + i * ADS_CODEC_LANES - 1));
+
+		// (d << 1) ^ (d >> 15), small magnitudes give small values
+		value = vxor(vsll1(value), vsign(value));
+		vstore(zigzag + i * ADS_CODEC_LANES, value);
+		any = vor(any, value);
+	}
+
+	uint16_t bits = vhor(any);
+	uint8_t width = 0;
+	while (bits) {
+		width++;
+		bits >>= 1;
+	}
+	return width;
+}
+
+/**************************************************************************/
+/*!
+	@brief  Bit-packs a group, lane by lane
+
+	@param zigzag ADS_CODEC_GROUP values
+	@param width bits per value, 1 to 16
+	@param out width * 16 bytes
+*/
+/**************************************************************************/
+static void packGroup(const uint16_t* zigzag, uint8_t width, uint8_t* out) {
+	vec_t word = vzero();
+	int used = 0;
+	for (int i = 0; i < ADS_CODEC_VECTORS; i++)
+	{
+		vec_t value = vload(zigzag + i * ADS_CODEC_LANES);
+		word = vor(word, vsll(value, used));
+		used += width;
+		if (used >= 16) {
+			vstore(out, word);
+			out += ADS_CODEC_LANES * 2;
+			used -= 16;
+			word = used ? vsrl(value, width - used) : vzero();
+		}
+	}
+}
+
+/**************************************************************************/
+/*!
+	@brief  Unpacks a group, the reverse of packGroup()
+
+	@param in width * 16 bytes
+	@param width bits per value, 1 to 16
+	@param zigzag ADS_CODEC_GROUP output values
+*/
+/**************************************************************************/
+static void unpackGroup(const uint8_t* in, uint8_t width, uint16_t* zigzag) {
+	vec_t mask = vset1((uint16_t)((1U << width) - 1));
+	vec_t word = vload(in);
+	in += ADS_CODEC_LANES * 2;
+	int position = 0;
+	for (int i = 0; i < ADS_CODEC_VECTORS; i++)
+	{
+		vec_t value = vsrl(word, position);
+		position += width;
+		if (position > 16) {
+			// The value straddles two words
+			word = vload(in);
+			in += ADS_CODEC_LANES * 2;
+			position -= 16;
+			value = vor(value, vsll(word, width - position));
+		}
+		else if (position == 16 && i < ADS_CODEC_VECTORS - 1) {
+			word = vload(in);
+			in += ADS_CODEC_LANES * 2;
+			position = 0;
+		}
+		vstore(zigzag + i * ADS_CODEC_LANES, vand(value, mask));
+	}
+}
+
+/**************************************************************************/
+/*!
+	@brief  Maps zigzag values back to codes
+
+	@param zigzag ADS_CODEC_GROUP values
+	@param mode ADS_CODEC_DELTA or ADS_CODEC_ZIGZAG
+	@param previous last code of the previous group (delta mode)
+	@param codes ADS_CODEC_GROUP output codes
+
+	@return the last code of the group
+*/
+/**************************************************************************/
+static int16_t decodeGroup(const uint16_t* zigzag, uint8_t mode, int16_t previous, int16_t* codes) {
+	vec_t one = vset1(1);
+	uint16_t carry = (uint16_t)previous;
+	for (int i = 0; i < ADS_CODEC_VECTORS; i++)
+	{
+		vec_t value = vload(zigzag + i * ADS_CODEC_LANES);
+
+		// (z >> 1) ^ -(z & 1)
+		value = vxor(vsrl1(value), vsub(vzero(), vand(value, one)));
+		if (mode == ADS_CODEC_DELTA) {
+			value = vprefix(value, carry);
+			carry = vlast(value);
+		}
+		vstore(codes + i * ADS_CODEC_LANES, value);
+	}
+
+	return (int16_t)codes[ADS_CODEC_GROUP - 1];
+}
+
+/**************************************************************************/
+/*!
+	@brief  Gets the largest encoded size of a column
+
+	@param count number of codes
+
+	@return the size in bytes
+*/
+/**************************************************************************/
+size_t adsCodecBound(size_t count) {
+	size_t groups = (count + ADS_CODEC_GROUP - 1) / ADS_CODEC_GROUP;
+	return 2 + groups * (1 + ADS_CODEC_GROUP * 2);
+}
+
+/**************************************************************************/
+/*!
+	@brief  Encodes a column of codes.  The last group is padded with
+			the last code, so it costs no extra width.
+
+	@param values codes to encode
+	@param count number of codes
+	@param mode ADS_CODEC_DELTA or ADS_CODEC_ZIGZAG
+	@param out output, at least adsCodecBound(count) bytes
+
+	@return the encoded size in bytes
+*/
+/**************************************************************************/
+size_t adsEncodeColumn(const int16_t* values, size_t count, uint8_t mode, uint8_t* out) {
+	int16_t first = count ? values[0] : 0;
+	out[0] = (uint8_t)first;
+	out[1] = (uint8_t)((uint16_t)first >> 8);
+	size_t size = 2;
+
+	// One code before the group for the delta of its first code
+	int16_t group[ADS_CODEC_GROUP + 1];
+	uint16_t zigzag[ADS_CODEC_GROUP];
+	int16_t previous = first;
+	for (size_t start = 0; start < count; start += ADS_CODEC_GROUP)
+	{
+		size_t n = count - start < ADS_CODEC_GROUP ? count - start : ADS_CODEC_GROUP;
+		const int16_t* codes;
+		if (n == ADS_CODEC_GROUP && start > 0) {
+			codes = values + start;
+		}
+		else {
+			group[0] = previous;
+			memcpy(group + 1, values + start, n * sizeof(int16_t));
+			for (size_t i = n; i < ADS_CODEC_GROUP; i++)
+				group[i + 1] = values[start + n - 1];
+			codes = group + 1;
+		}
+
+		uint8_t width = encodeGroup(codes, mode, zigzag);
+		out[size++] = width;
+		if (width) {
+			packGroup(zigzag, width, out + size);
+			size += width * ADS_CODEC_LANES * 2;
+		}
+		previous = values[start + n - 1];
+	}
+
+	return size;
+}
+
+/**************************************************************************/
+/*!
+	@brief  Decodes a column encoded by adsEncodeColumn()
+
+	@param in encoded column
+	@param size bytes available in in
+	@param count number of codes to decode
+	@param mode mode used to encode
+	@param values output, count codes
+
+	@return the number of bytes used, 0 if in is truncated or invalid
+*/
+/**************************************************************************/
+size_t adsDecodeColumn(const uint8_t* in, size_t size, size_t count, uint8_t mode, int16_t* values) {
+	if (size < 2)
+		return 0;
+
+	int16_t previous = (int16_t)(in[0] | (in[1] << 8));
+	size_t used = 2;
+
+	uint16_t zigzag[ADS_CODEC_GROUP];
+	int16_t group[ADS_CODEC_GROUP];
+	for (size_t start = 0; start < count; start += ADS_CODEC_GROUP)
+	{
+		if (used >= size || in[used] > 16)
+			return 0;
+
+		uint8_t width = in[used++];
+		size_t bytes = width * ADS_CODEC_LANES * 2;
+		if (used + bytes > size)
+			return 0;
+
+		if (width)
+			unpackGroup(in + used, width, zigzag);
+		else
+			memset(zigzag, 0, sizeof(zigzag));
+		used += bytes;
+
+		// Full groups go straight to the output, the last one through a copy
+		size_t n = count - start < ADS_CODEC_GROUP ? count - start : ADS_CODEC_GROUP;
+		int16_t* codes = n == ADS_CODEC_GROUP ? values + start : group;
+		previous = decodeGroup(zigzag, mode, previous, codes);
+		if (codes == group)
+			memcpy(values + start, group, n * sizeof(int16_t));
+	}
+
+	return used;
+}
+
+/**************************************************************************/
+/*!
+	@brief  Appends an unsigned LEB128 varint
+*/
+/**************************************************************************/
+static void putVarint(std::vector<uint8_t>& out, uint64_t value) {
+	while (value >= 0x80) {
+		out.push_back((uint8_t)(value | 0x80));
+		value >>= 7;
+	}
+	out.push_back((uint8_t)value);
+}
+
+/**************************************************************************/
+/*!
+	@brief  Reads an unsigned LEB128 varint
+
+	@return 1 on success, -1 if truncated
+*/
+/**************************************************************************/
+static int getVarint(const uint8_t* in, size_t size, size_t* used, uint64_t* value) {
+	*value = 0;
+	for (int shift = 0; shift < 64; shift += 7)
+	{
+		if (*used >= size)
+			return -1;
+
+		uint8_t byte = in[(*used)++];
+		*value |= (uint64_t)(byte & 0x7F) << shift;
+		if (!(byte & 0x80))
+			return 1;
+	}
+
+	return -1;
+}
+
+/**************************************************************************/
+/*!
+	@brief  Appends a little-endian integer
+*/
+/**************************************************************************/
+static void putLittleEndian(std::vector<uint8_t>& out, uint64_t value, int bytes) {
+	for (int i = 0; i < bytes; i++)
+		out.push_back((uint8_t)(value >> (8 * i)));
+}
+
+/**************************************************************************/
+/*!
+	@brief  Reads a little-endian integer, the bounds are checked by the caller
+*/
+/**************************************************************************/
+static uint64_t getLittleEndian(const uint8_t* in, int bytes) {
+	uint64_t value = 0;
+	for (int i = 0; i < bytes; i++)
+		value |= (uint64_t)in[i] << (8 * i);
+	return value;
+}
+
+/**************************************************************************/
+/*!
+	@brief  Encodes the complete rows of a block: header (chip, gain,
+			data rate, inputs), timestamps as varint zigzag
+			delta-of-deltas, then one encoded column per channel
+
+	@param block block to encode
+	@param mode ADS_CODEC_DELTA or ADS_CODEC_ZIGZAG
+	@param out output, replaced
+
+	@return the encoded size in bytes
+*/
+/**************************************************************************/
+size_t adsEncodeBlock(const adsSampleBlock& block, uint8_t mode, std::vector<uint8_t>& out) {
+	size_t rows = block.size();
+	size_t channels = block.channelCount();
+
+	out.clear();
+	out.reserve(16 + channels + rows * 2 + channels * adsCodecBound(rows));
+	out.push_back('A');
+	out.push_back('D');
+	out.push_back('S');
+	out.push_back('B');
+	out.push_back(ADS_CODEC_VERSION);
+	out.push_back(mode);
+	out.push_back((uint8_t)channels);
+	out.push_back(block.adsType());
+	putLittleEndian(out, block.gain(), 2);
+	putLittleEndian(out, block.sps(), 2);
+	putLittleEndian(out, rows, 4);
+	for (size_t i = 0; i < channels; i++)
+		out.push_back(block.input(i));
+
+	// Regular sampling: the delta-of-delta is the jitter
+	const uint64_t* timestamps = block.timestamps();
+	if (rows)
+		putLittleEndian(out, timestamps[0], 8);
+	int64_t previousDelta = 0;
+	for (size_t i = 1; i < rows; i++)
+	{
+		int64_t delta = (int64_t)(timestamps[i] - timestamps[i - 1]);
+		int64_t deltaOfDelta = delta - previousDelta;
+		putVarint(out, ((uint64_t)deltaOfDelta << 1) ^ (uint64_t)(deltaOfDelta >> 63));
+		previousDelta = delta;
+	}
+
+	for (size_t i = 0; i < channels; i++)
+	{
+		size_t offset = out.size();
+		out.resize(offset + adsCodecBound(rows));
+		out.resize(offset + adsEncodeColumn(block.column(i), rows, mode, &out[offset]));
+	}
+
+	return out.size();
+}
+
+/**************************************************************************/
+/*!
+	@brief  Decodes a block encoded by adsEncodeBlock(), the block is
+			created with the encoded inputs and rows
+
+	@param in encoded block
+	@param size size of in
+	@param block output block
+
+	@return 1 on success, -1 on error
+*/
+/**************************************************************************/
+int adsDecodeBlock(const uint8_t* in, size_t size, adsSampleBlock& block) {
+	if (size < 16 || memcmp(in, "ADSB", 4) || in[4] != ADS_CODEC_VERSION || in[6] == 0) {
+		fprintf(stderr, "Error while decoding a sample block! Unknown header\n");
+		return -1;
+	}
+
+	uint8_t mode = in[5];
+	if (mode != ADS_CODEC_DELTA && mode != ADS_CODEC_ZIGZAG) {
+		fprintf(stderr, "Error while decoding a sample block! Unknown mode %u\n", mode);
+		return -1;
+	}
+
+	size_t channels = in[6];
+	size_t rows = getLittleEndian(in + 12, 4);
+	size_t used = 16 + channels;
+	if (used > size) {
+		fprintf(stderr, "Error while decoding a sample block! Truncated header\n");
+		return -1;
+	}
+
+	// The row count is not trusted before the allocation: every row takes
+	// at least one timestamp byte, every column 2 bytes plus one per group
+	size_t remaining = size - used;
+	if (rows && (rows + 7 > remaining ||
+		8 + (rows - 1) + channels * (2 + (rows + ADS_CODEC_GROUP - 1) / ADS_CODEC_GROUP) > remaining)) {
+		fprintf(stderr, "Error while decoding a sample block! %zu rows do not fit in %zu bytes\n", rows, remaining);
+		return -1;
+	}
+
+	if (block.create(in + 16, channels, rows ? rows : 1) < 0) {
+		fprintf(stderr, "Error while decoding a sample block! Invalid header\n");
+		return -1;
+	}
+	block.setMetadata(in[7], (adsGain_t)getLittleEndian(in + 8, 2), (adsSps_t)getLittleEndian(in + 10, 2));
+
+	uint64_t* timestamps = block.timestamps();
+	if (rows) {
+		if (used + 8 > size) {
+			fprintf(stderr, "Error while decoding a sample block! Truncated timestamps\n");
+			return -1;
+		}
+		timestamps[0] = getLittleEndian(in + used, 8);
+		used += 8;
+	}
+	int64_t delta = 0;
+	for (size_t i = 1; i < rows; i++)
+	{
+		uint64_t zigzag;
+		if (getVarint(in, size, &used, &zigzag) < 0) {
+			fprintf(stderr, "Error while decoding a sample block! Truncated timestamps\n");
+			return -1;
+		}
+		delta += (int64_t)(zigzag >> 1) ^ -(int64_t)(zigzag & 1);
+		timestamps[i] = timestamps[i - 1] + delta;
+	}
+
+	for (size_t i = 0; i < channels; i++)
+	{
+		size_t columnBytes = adsDecodeColumn(in + used, size - used, rows, mode, block.column(i));
+		if (!columnBytes) {
+			fprintf(stderr, "Error while decoding a sample block! Truncated column %zu\n", i);
+			return -1;
+		}
+		used += columnBytes;
+	}
+
+	return block.commitRows(rows);
+}
+
+/**************************************************************************/
+/*!
+	@brief  Gets the kernel the codec was built with
+
+	@return "sse2", "neon" or "scalar"
+*/
+/**************************************************************************/
+const char* adsCodecKernel() {
+#if defined(ADS_CODEC_SSE2)
+	return "sse2";
+#elif defined(ADS_CODEC_NEON)
+	return "neon";
+#else
+	return "scalar";
+#endif
+}
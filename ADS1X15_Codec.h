@@ -0,0 +1,51 @@
+/**************************************************************************/
+/*!
+    @file     ADS1X15_Codec.h
+
+    Compact encoding of sample columns and blocks for storage and
+    telemetry.
+
+    A column is split in groups of ADS_CODEC_GROUP codes. Each code is
+    turned into a small unsigned integer, either the zigzag of the delta
+    with the previous code (slow signals) or the zigzag of the code
+    itself (noise around zero), and every group is bit-packed with the
+    width of its own largest value, so a 12-bit code varying by a few
+    LSBs takes 2-4 bits. Differences wrap modulo 2^16, so 16-bit codes
+    always round-trip.
+
+    The packing is vertical: 8 lanes of 16 bits, one lane per position in
+    an 8-code vector, so the SSE2 and NEON kernels encode and decode one
+    vector per instruction (a scalar kernel produces the same bytes).
+    Blocks add a small header and the timestamps as varint
+    delta-of-deltas. Payloads are little-endian.
+
+    @section license License
+
+    BSD license, all text here must be included in any redistribution
+*/
+/**************************************************************************/
+
+#ifndef ADS1X15_CODEC_H
+#define ADS1X15_CODEC_H
+
+#include <vector>
+
+#include "ADS1X15_SampleBlock.h"
+
+/*=========================================================================
+    CODEC SETTINGS
+    -----------------------------------------------------------------------*/
+#define ADS_CODEC_DELTA   (0)   ///< Zigzag of the delta with the previous code
+#define ADS_CODEC_ZIGZAG  (1)   ///< Zigzag of the code
+#define ADS_CODEC_GROUP   (128) ///< Codes per bit-packed group
+#define ADS_CODEC_VERSION (1)   ///< Block format version
+/*=========================================================================*/
+
+size_t      adsCodecBound(size_t count);
+size_t      adsEncodeColumn(const int16_t* values, size_t count, uint8_t mode, uint8_t* out);
+size_t      adsDecodeColumn(const uint8_t* in, size_t size, size_t count, uint8_t mode, int16_t* values);
+size_t      adsEncodeBlock(const adsSampleBlock& block, uint8_t mode, std::vector<uint8_t>& out);
+int         adsDecodeBlock(const uint8_t* in, size_t size, adsSampleBlock& block);
+const char* adsCodecKernel(void);
+
+#endif // ADS1X15_CODEC_H
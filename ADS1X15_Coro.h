@@ -0,0 +1,427 @@
+/**************************************************************************/
+/*!
+    @file     ADS1X15_Coro.h
+
+    C++20 coroutine API for awaitable conversions (compile with -std=c++20).
+
+    Wrap each device in an adsCoroDevice bound to an adsCoroScheduler and
+    co_await its reads from adsTask coroutines:
+
+        adsTask sample(adsCoroDevice& adc, const std::vector<uint8_t>& inputs) {
+            uint16_t ain0 = co_await adc.readSingleEnded(0);
+            std::vector<int16_t> all = co_await adc.scan(inputs);
+        }
+
+    A failed transaction ends the read: the status awaitables return -1,
+    scans return an empty vector or false and the value awaitables return
+    0 like the driver calls they mirror.
+
+    The scheduler runs on one thread. It starts the conversions, sleeps
+    until the earliest conversion time (see setConversionDelay()), checks
+    the OS bit and resumes the coroutine whose result is ready. Devices
+    convert in parallel; the requests to one device are queued in order,
+    so any number of coroutines can be in flight without extra threads.
+
+    This header is self-contained, the library itself does not need to be
+    built with C++20.
+
+    @section license License
+
+    BSD license, all text here must be included in any redistribution
+*/
+/**************************************************************************/
+
+#ifndef ADS1X15_CORO_H
+#define ADS1X15_CORO_H
+
+#if __cplusplus < 202002L
+#error "ADS1X15_Coro.h requires C++20 (-std=c++20)"
+#endif
+
+#include <coroutine>
+#include <exception>
+#include <queue>
+#include <vector>
+
+#include "ADS1X15_SampleBlock.h"
+#include "ADS1X15_TLA2024.h"
+
+/*=========================================================================
+    COROUTINE SETTINGS
+    -----------------------------------------------------------------------*/
+#define ADS_CORO_POLL_INTERVAL (50) ///< Re-check delay in uS when a conversion is late
+/*=========================================================================*/
+
+class adsCoroScheduler;
+class adsCoroDevice;
+
+/**************************************************************************/
+/*!
+    @brief  Fire-and-forget coroutine type, starts immediately and frees
+            itself when it returns
+*/
+/**************************************************************************/
+struct adsTask {
+    struct promise_type {
+        adsTask get_return_object() { return adsTask(); }
+        std::suspend_never initial_suspend() noexcept { return {}; }
+        std::suspend_never final_suspend() noexcept { return {}; }
+        void return_void() {}
+        void unhandled_exception() { std::terminate(); }
+    };
+};
+
+/**************************************************************************/
+/*!
+    @brief  One awaited read: a list of inputs converted in turn on one
+            device, or the next result of a continuous comparator.
+            Lives in the awaiting coroutine frame while suspended.
+*/
+/**************************************************************************/
+class adsCoroRead {
+public:
+    adsCoroRead(adsCoroDevice* device, const std::vector<uint8_t>& inputs, bool comparator)
+        : m_device(device), m_inputs(inputs), m_next(0), m_comparator(comparator),
+          m_failed(false), m_deadlineNs(0), m_rowNs(0), m_queueNext(NULL), m_block(NULL) {}
+
+    bool await_ready() const noexcept { return m_inputs.empty() && !m_comparator; }
+    inline void await_suspend(std::coroutine_handle<> handle);
+
+protected:
+    friend class adsCoroScheduler;
+    friend class adsCoroDevice;
+
+    adsCoroDevice*          m_device;
+    std::vector<uint8_t>    m_inputs;     ///< ADS_INPUT_* settings to convert
+    std::vector<int16_t>    m_results;    ///< one result per input
+    size_t                  m_next;       ///< input being converted
+    bool                    m_comparator; ///< read the running conversion only
+    bool                    m_failed;     ///< a conversion could not be read
+    uint64_t                m_deadlineNs; ///< time the conversion should be complete
+    uint64_t                m_rowNs;      ///< time of the first result, for blocks
+    std::coroutine_handle<> m_handle;
+    adsCoroRead*            m_queueNext;  ///< next read queued on the device
+    adsSampleBlock*         m_block;      ///< block receiving the results, if any
+};
+
+/** Awaitable returning a single result */
+class adsCoroValue : public adsCoroRead {
+public:
+    using adsCoroRead::adsCoroRead;
+    int16_t await_resume() const { return m_failed || m_results.empty() ? 0 : m_results[0]; }
+};
+
+/** Awaitable returning 1 and the result through a pointer, or -1 on failure */
+class adsCoroStatus : public adsCoroRead {
+public:
+    adsCoroStatus(adsCoroDevice* device, const std::vector<uint8_t>& inputs, bool comparator, int16_t* value)
+        : adsCoroRead(device, inputs, comparator), m_value(value) {}
+    inline int await_resume() const;
+
+private:
+    int16_t* m_value;
+};
+
+/** Awaitable returning a single-ended result unsigned, as readADC_SingleEnded() */
+class adsCoroSingleEnded : public adsCoroRead {
+public:
+    using adsCoroRead::adsCoroRead;
+    inline uint16_t await_resume() const;
+};
+
+/** Awaitable returning one result per scanned input, none on failure */
+class adsCoroScan : public adsCoroRead {
+public:
+    using adsCoroRead::adsCoroRead;
+    std::vector<int16_t> await_resume() {
+        if (m_failed)
+            m_results.clear();
+        return std::move(m_results);
+    }
+};
+
+/** Awaitable appending one row to a sample block, returns false if it was full or a conversion failed */
+class adsCoroBlockScan : public adsCoroRead {
+public:
+    adsCoroBlockScan(adsCoroDevice* device, adsSampleBlock& block)
+        : adsCoroRead(device, std::vector<uint8_t>(), false) {
+        m_block = &block;
+        if (block.headroom() > 0)
+            for (size_t i = 0; i < block.channelCount(); i++)
+                m_inputs.push_back(block.input(i));
+    }
+    bool await_resume() const { return !m_inputs.empty() && !m_failed; }
+};
+
+/**************************************************************************/
+/*!
+    @brief  Single-threaded scheduler resuming coroutines when their
+            conversions complete
+*/
+/**************************************************************************/
+class adsCoroScheduler {
+public:
+    adsCoroScheduler() : m_inFlight(0) {}
+
+    /** @return the number of reads started or queued */
+    size_t pending() const { return m_inFlight; }
+
+    /** @return the time of the next conversion check, 0 if idle */
+    uint64_t nextDeadlineNs() const { return m_timers.empty() ? 0 : m_timers.top().deadlineNs; }
+
+    /**************************************************************************/
+    /*!
+        @brief  Processes every conversion due by now, without sleeping.
+                Suitable for an external event loop using nextDeadlineNs().
+
+        @return the number of coroutines resumed
+    */
+    /**************************************************************************/
+    size_t poll() {
+        size_t resumed = 0;
+        uint64_t now = adsTimestampNs();
+        while (!m_timers.empty() && m_timers.top().deadlineNs <= now) {
+            adsCoroRead* read = m_timers.top().read;
+            m_timers.pop();
+            if (step(read))
+                resumed++;
+        }
+        return resumed;
+    }
+
+    /**************************************************************************/
+    /*!
+        @brief  Sleeps until the next conversion is due and processes it
+
+        @return false when nothing is in flight
+    */
+    /**************************************************************************/
+    bool runOnce() {
+        if (m_timers.empty())
+            return false;
+
+        struct timespec ts;
+        uint64_t deadline = m_timers.top().deadlineNs;
+        ts.tv_sec = deadline / 1000000000ULL;
+        ts.tv_nsec = deadline % 1000000000ULL;
+        while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, NULL) == EINTR)
+            ;
+
+        poll();
+        return true;
+    }
+
+    /**************************************************************************/
+    /*!
+        @brief  Runs until every coroutine has stopped awaiting
+    */
+    /**************************************************************************/
+    void run() {
+        while (runOnce())
+            ;
+    }
+
+private:
+    friend class adsCoroDevice;
+
+    typedef struct {
+        uint64_t     deadlineNs;
+        adsCoroRead* read;
+    } pending_t;
+
+    struct timerLater {
+        bool operator()(const pending_t& a, const pending_t& b) const { return a.deadlineNs > b.deadlineNs; }
+    };
+
+    inline void start(adsCoroRead* read);
+    inline bool step(adsCoroRead* read);
+
+    void schedule(adsCoroRead* read, uint64_t deadlineNs) {
+        read->m_deadlineNs = deadlineNs;
+        pending_t timer = { deadlineNs, read };
+        m_timers.push(timer);
+    }
+
+    std::priority_queue<pending_t, std::vector<pending_t>, timerLater> m_timers;
+    size_t m_inFlight;
+};
+
+/**************************************************************************/
+/*!
+    @brief  Device wrapper providing awaitable reads.  Reads are queued
+            per device and run one at a time, in order.
+*/
+/**************************************************************************/
+class adsCoroDevice {
+public:
+    adsCoroDevice(adsCoroScheduler& scheduler, TLA2024& device)
+        : m_scheduler(&scheduler), m_device(&device), m_head(NULL), m_tail(NULL) {}
+
+    /** @return the wrapped driver */
+    TLA2024& device() { return *m_device; }
+
+    /** Awaitable single-ended reading, see readADC_SingleEnded() */
+    adsCoroSingleEnded readSingleEnded(uint8_t channel) {
+        if (channel > 3)
+            return adsCoroSingleEnded(this, std::vector<uint8_t>(), false);
+        return adsCoroSingleEnded(this, std::vector<uint8_t>(1, ADS_INPUT_SINGLE(channel)), false);
+    }
+
+    /** Awaitable differential reading, see readADC_Differential_0_1() */
+    adsCoroValue readDifferential_0_1() { return adsCoroValue(this, std::vector<uint8_t>(1, ADS_INPUT_DIFF_0_1), false); }
+
+    /** Awaitable differential reading, see readADC_Differential_2_3() */
+    adsCoroValue readDifferential_2_3() { return adsCoroValue(this, std::vector<uint8_t>(1, ADS_INPUT_DIFF_2_3), false); }
+
+    /** Awaitable reading of any multiplexer setting, see readADC_Input() */
+    adsCoroValue readInput(uint8_t input) { return adsCoroValue(this, std::vector<uint8_t>(1, input), false); }
+
+    /** Awaitable reading of any multiplexer setting, returns 1 or -1 like readADC_Input(input, value) */
+    adsCoroStatus readInput(uint8_t input, int16_t* value) {
+        return adsCoroStatus(this, std::vector<uint8_t>(1, input), false, value);
+    }
+
+    /** Awaitable conversion of several inputs in turn, one result per input */
+    adsCoroScan scan(const std::vector<uint8_t>& inputs) { return adsCoroScan(this, inputs, false); }
+
+    /** Awaitable scan of the block inputs, appended as one row of the block */
+    adsCoroBlockScan scan(adsSampleBlock& block) { return adsCoroBlockScan(this, block); }
+
+    /**
+        Awaitable next result of a comparator started with
+        startComparator_SingleEnded(), see getLastConversionResults()
+    */
+    adsCoroValue comparator() { return adsCoroValue(this, std::vector<uint8_t>(), true); }
+
+    /** Awaitable next comparator result, returns 1 or -1 like readConversionResult(value) */
+    adsCoroStatus comparator(int16_t* value) { return adsCoroStatus(this, std::vector<uint8_t>(), true, value); }
+
+private:
+    friend class adsCoroRead;
+    friend class adsCoroScheduler;
+
+    /** Queues a read, starts it if the device is idle */
+    void enqueue(adsCoroRead* read) {
+        read->m_queueNext = NULL;
+        if (m_tail)
+            m_tail->m_queueNext = read;
+        else
+            m_head = read;
+        m_tail = read;
+
+        m_scheduler->m_inFlight++;
+        if (m_head == read)
+            m_scheduler->start(read);
+    }
+
+    /** Removes the finished head read and starts the next one */
+    void dequeue() {
+        m_head = m_head->m_queueNext;
+        if (!m_head)
+            m_tail = NULL;
+        m_scheduler->m_inFlight--;
+
+        if (m_head)
+            m_scheduler->start(m_head);
+    }
+
+    adsCoroScheduler* m_scheduler;
+    TLA2024*          m_device;
+    adsCoroRead*      m_head; ///< read in progress
+    adsCoroRead*      m_tail; ///< last queued read
+};
+
+/**************************************************************************/
+/*!
+    @brief  Suspends the awaiting coroutine until the read completes
+*/
+/**************************************************************************/
+inline void adsCoroRead::await_suspend(std::coroutine_handle<> handle) {
+    m_handle = handle;
+    m_results.reserve(m_inputs.size() ? m_inputs.size() : 1);
+    m_device->enqueue(this);
+}
+
+/**************************************************************************/
+/*!
+    @brief  Gets the single-ended result like readADC_SingleEnded(): the
+            12-bit codes are not sign extended
+*/
+/**************************************************************************/
+inline uint16_t adsCoroSingleEnded::await_resume() const {
+    if (m_results.empty())
+        return 0;
+
+    uint16_t mask = m_device->device().getAdsType() == ads1115 ? 0xFFFF : 0x0FFF;
+    return (uint16_t)m_results[0] & mask;
+}
+
+/**************************************************************************/
+/*!
+    @brief  Gets the status of the read and stores its result
+*/
+/**************************************************************************/
+inline int adsCoroStatus::await_resume() const {
+    if (m_failed || m_results.empty())
+        return -1;
+
+    *m_value = m_results[0];
+    return 1;
+}
+
+/**************************************************************************/
+/*!
+    @brief  Starts the current conversion of a read
+*/
+/**************************************************************************/
+inline void adsCoroScheduler::start(adsCoroRead* read) {
+    TLA2024* device = read->m_device->m_device;
+
+    // Comparator devices convert continuously, only the delay is tracked
+    if (!read->m_comparator)
+        device->startADC_Input(read->m_inputs[read->m_next]);
+
+    schedule(read, adsTimestampNs() + (uint64_t)device->getConversionDelay() * 1000);
+}
+
+/**************************************************************************/
+/*!
+    @brief  Checks a due conversion, collects it and moves the read on
+
+    @return true if the awaiting coroutine was resumed
+*/
+/**************************************************************************/
+inline bool adsCoroScheduler::step(adsCoroRead* read) {
+    TLA2024* device = read->m_device->m_device;
+
+    if (!read->m_comparator && !device->isConversionReady()) {
+        schedule(read, adsTimestampNs() + ADS_CORO_POLL_INTERVAL * 1000);
+        return false;
+    }
+
+    // A failed read ends the whole request, nothing is made up
+    int16_t value;
+    if (device->readConversionResult(&value) < 0) {
+        read->m_failed = true;
+    } else {
+        if (read->m_results.empty())
+            read->m_rowNs = adsTimestampNs();
+        read->m_results.push_back(value);
+        if (!read->m_comparator && ++read->m_next < read->m_inputs.size()) {
+            start(read);
+            return false;
+        }
+
+        // Block rows are only appended once every input converted
+        if (read->m_block)
+            read->m_block->appendRow(read->m_results.data(), read->m_rowNs);
+    }
+
+    // Hand the device to the next read before the coroutine runs again
+    std::coroutine_handle<> handle = read->m_handle;
+    read->m_device->dequeue();
+    handle.resume();
+    return true;
+}
+
+#endif // ADS1X15_CORO_H
@@ -0,0 +1,146 @@
+/**************************************************************************/
+/*!
+	@file     ADS1X15_Deadband.cpp
+
+	Report-by-exception filter for quasi-static channels.
+
+	@section license License
+
+	BSD license, all text here must be included in any redistribution
+*/
+/**************************************************************************/
+
+#include "ADS1X15_Deadband.h"
+
+/**************************************************************************/
+/*!
+	@brief  Instantiates a filter with the same settings on every channel
+
+	@param channelCount number of channels, samples of other channels are
+			always reported
+	@param deadband codes a value may move without being reported
+	@param heartbeatMs longest time without a report, 0 for none
+*/
+/**************************************************************************/
+adsDeadband::adsDeadband(size_t channelCount, uint16_t deadband, uint32_t heartbeatMs)
+{
+	m_channels.resize(channelCount);
+	for (size_t i = 0; i < m_channels.size(); i++)
+		setChannel(i, deadband, heartbeatMs);
+	reset();
+}
+
+/**************************************************************************/
+/*!
+	@brief  Changes the settings of one channel
+
+	@param channel channel index of the samples
+	@param deadband codes a value may move without being reported
+	@param heartbeatMs longest time without a report, 0 for none
+
+	@return 1 on success, -1 if the channel is out of range
+*/
+/**************************************************************************/
+int adsDeadband::setChannel(uint8_t channel, uint16_t deadband, uint32_t heartbeatMs) {
+	if (channel >= m_channels.size())
+		return -1;
+
+	m_channels[channel].deadband = deadband;
+	m_channels[channel].heartbeatNs = (uint64_t)heartbeatMs * 1000000;
+	return 1;
+}
+
+/**************************************************************************/
+/*!
+	@brief  Decides if a sample is reported and updates the counters
+
+	@return true if the sample should go downstream
+*/
+/**************************************************************************/
+bool adsDeadband::filter(const adsSample_t& sample) {
+	if (sample.channel >= m_channels.size())
+		return true;
+
+	channel_t* channel = &m_channels[sample.channel];
+	if (channel->reported) {
+		int32_t change = (int32_t)sample.value - channel->lastValue;
+		bool moved = change > channel->deadband || -change > channel->deadband;
+		bool beat = channel->heartbeatNs && sample.timestampNs - channel->lastNs >= channel->heartbeatNs;
+
+		if (!moved && sample.alert == channel->lastAlert) {
+			if (!beat) {
+				channel->stats.suppressed++;
+				return false;
+			}
+			channel->stats.heartbeats++;
+		}
+	}
+
+	channel->reported = true;
+	channel->lastValue = sample.value;
+	channel->lastAlert = sample.alert;
+	channel->lastNs = sample.timestampNs;
+	channel->stats.reported++;
+	return true;
+}
+
+/**************************************************************************/
+/*!
+	@brief  Forwards the sample to the sinks if it is reported
+*/
+/**************************************************************************/
+void adsDeadband::onSample(const adsSample_t& sample) {
+	if (!filter(sample))
+		return;
+
+	for (size_t i = 0; i < m_sinks.size(); i++)
+		m_sinks[i]->onSample(sample);
+}
+
+/**************************************************************************/
+/*!
+	@brief  Adds a stage fed with the reported samples
+
+	@param sink stage to feed, must outlive the filter
+*/
+/**************************************************************************/
+void adsDeadband::addSink(adsSampleSink* sink) {
+	m_sinks.push_back(sink);
+}
+
+/**************************************************************************/
+/*!
+	@brief  Clears the counters, the next sample of every channel is
+			reported
+*/
+/**************************************************************************/
+void adsDeadband::reset() {
+	for (size_t i = 0; i < m_channels.size(); i++)
+	{
+		m_channels[i].reported = false;
+		m_channels[i].lastValue = 0;
+		m_channels[i].lastAlert = 0;
+		m_channels[i].lastNs = 0;
+		memset(&m_channels[i].stats, 0, sizeof(m_channels[i].stats));
+	}
+}
+
+/**************************************************************************/
+/*!
+	@brief  Gets the number of filtered channels
+*/
+/**************************************************************************/
+size_t adsDeadband::channelCount() const {
+	return m_channels.size();
+}
+
+/**************************************************************************/
+/*!
+	@brief  Gets the counters of a channel
+
+	@param channel channel index, out of range gives the first channel
+*/
+/**************************************************************************/
+const adsDeadbandStats_t& adsDeadband::stats(uint8_t channel) const {
+	return m_channels[channel < m_channels.size() ? channel : 0].stats;
+}
@@ -0,0 +1,70 @@
+/**************************************************************************/
+/*!
+    @file     ADS1X15_Deadband.h
+
+    Report-by-exception filter for quasi-static channels.
+
+    The library keeps sampling at full rate; the filter only decides which
+    samples go further. A sample is reported when it moves more than the
+    deadband (in codes) away from the last reported value of its channel,
+    when its comparator alert changes, or when the heartbeat interval has
+    elapsed since the last report, so a consumer can tell a constant
+    signal from a dead one. The first sample of a channel is reported.
+
+    Used as a sink it forwards the reported samples to its own sinks, so
+    statistics can see every sample while storage or IPC only sees the
+    changes. adsAcquisition::setFilter() also applies it to the samples
+    drain() returns (not to the sample blocks, which keep every sample).
+
+    @section license License
+
+    BSD license, all text here must be included in any redistribution
+*/
+/**************************************************************************/
+
+#ifndef ADS1X15_DEADBAND_H
+#define ADS1X15_DEADBAND_H
+
+#include <vector>
+
+#include "ADS1X15_TLA2024.h"
+
+/** Filter counters of one channel */
+typedef struct {
+    uint64_t reported;    ///< samples passed downstream
+    uint64_t suppressed;  ///< samples within the deadband
+    uint64_t heartbeats;  ///< reported only because the heartbeat elapsed
+} adsDeadbandStats_t;
+
+/**************************************************************************/
+/*!
+    @brief  Per-channel deadband and heartbeat filter stage
+*/
+/**************************************************************************/
+class adsDeadband : public adsSampleSink {
+public:
+    adsDeadband(size_t channelCount = ADS_INPUT_COUNT, uint16_t deadband = 0, uint32_t heartbeatMs = 0);
+    int    setChannel(uint8_t channel, uint16_t deadband, uint32_t heartbeatMs = 0);
+    bool   filter(const adsSample_t& sample);
+    void   onSample(const adsSample_t& sample);
+    void   addSink(adsSampleSink* sink);
+    void   reset(void);
+    size_t channelCount(void) const;
+    const adsDeadbandStats_t& stats(uint8_t channel) const;
+
+private:
+    typedef struct {
+        uint16_t           deadband;     ///< codes a value may move unreported
+        uint64_t           heartbeatNs;  ///< 0 for no heartbeat
+        bool               reported;     ///< a value was reported
+        int16_t            lastValue;
+        uint8_t            lastAlert;
+        uint64_t           lastNs;
+        adsDeadbandStats_t stats;
+    } channel_t;
+
+    std::vector<channel_t>      m_channels;
+    std::vector<adsSampleSink*> m_sinks;
+};
+
+#endif // ADS1X15_DEADBAND_H
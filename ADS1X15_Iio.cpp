@@ -0,0 +1,537 @@
+/**************************************************************************/
+/*!
+	@file     ADS1X15_Iio.cpp
+
+	Linux IIO transport for the chips bound to the mainline ti-ads1015
+	kernel driver.
+
+	@section license License
+
+	BSD license, all text here must be included in any redistribution
+*/
+/**************************************************************************/
+
+#include <dirent.h>
+#include <limits.h>
+
+#include "ADS1X15_Iio.h"
+
+/// Channel names of the kernel driver, indexed by ADS_INPUT_* (the scan index)
+static const char* channelNames[ADS_INPUT_COUNT] = {
+	"voltage0-voltage1", "voltage0-voltage3", "voltage1-voltage3", "voltage2-voltage3",
+	"voltage0", "voltage1", "voltage2", "voltage3"
+};
+
+/// sampling_frequency values indexed by the DR bits
+static const uint16_t ads1015Rates[8] = { 128, 250, 490, 920, 1600, 2400, 3300, 3300 };
+static const uint16_t ads1115Rates[8] = { 8, 16, 32, 64, 128, 250, 475, 860 };
+
+/// Full scale ranges in mV indexed by the PGA bits
+static const uint16_t fullScales[6] = { 6144, 4096, 2048, 1024, 512, 256 };
+
+/**************************************************************************/
+/*!
+	@brief  Instantiates a closed IIO transport
+
+	@param sysfsRoot directory holding the iio:deviceN entries
+	@param devRoot directory holding the iio:deviceN character devices
+*/
+/**************************************************************************/
+adsIio::adsIio(const char* sysfsRoot, const char* devRoot)
+{
+	snprintf(m_sysfsRoot, sizeof(m_sysfsRoot), "%s", sysfsRoot);
+	snprintf(m_devRoot, sizeof(m_devRoot), "%s", devRoot);
+	m_trigger[0] = '\0';
+	m_index = -1;
+	m_fd = -1;
+	m_bufferInput = 0;
+	m_hasTimestamp = false;
+	m_scanBytes = 0;
+	memset(&m_value, 0, sizeof(m_value));
+	memset(&m_timestamp, 0, sizeof(m_timestamp));
+	memset(m_gains, 0xFF, sizeof(m_gains));
+	memset(m_rates, 0xFF, sizeof(m_rates));
+}
+
+/**************************************************************************/
+/*!
+	@brief  Stops the buffer, if running
+*/
+/**************************************************************************/
+adsIio::~adsIio()
+{
+	close();
+}
+
+/**************************************************************************/
+/*!
+	@brief  Finds the IIO device the kernel created for a chip
+
+	@param i2cDeviceName I2C device name, e.g. /dev/i2c-1
+	@param i2cAddress I2C address of the chip
+
+	@return 1 on success, -1 if no IIO device sits on that address
+*/
+/**************************************************************************/
+int adsIio::open(const char* i2cDeviceName, uint8_t i2cAddress) {
+	const char* bus = strrchr(i2cDeviceName, '-');
+	if (!bus) {
+		fprintf(stderr, "Error while parsing the bus number of %s!\n", i2cDeviceName);
+		return -1;
+	}
+
+	// The device directory is a link into .../i2c-N/N-00AA/iio:deviceM
+	char parent[32];
+	snprintf(parent, sizeof(parent), "/%d-%04x/", atoi(bus + 1), i2cAddress);
+
+	DIR* dir = opendir(m_sysfsRoot);
+	if (!dir) {
+		fprintf(stderr, "Error while opening %s! Error: %s\n", m_sysfsRoot, strerror(errno));
+		return -1;
+	}
+
+	int found = -1;
+	struct dirent* entry;
+	while (found < 0 && (entry = readdir(dir)) != NULL)
+	{
+		int index;
+		if (sscanf(entry->d_name, "iio:device%d", &index) != 1)
+			continue;
+
+		char path[ADS_IIO_PATH_LENGTH * 2];
+		char real[PATH_MAX];
+		snprintf(path, sizeof(path), "%s/%s", m_sysfsRoot, entry->d_name);
+		if (realpath(path, real) && strstr(real, parent))
+			found = index;
+	}
+	closedir(dir);
+
+	if (found < 0) {
+		fprintf(stderr, "Error while looking for the IIO device of %s 0x%02X! Is the ti-ads1015 driver bound?\n", i2cDeviceName, i2cAddress);
+		return -1;
+	}
+
+	return openIndex(found);
+}
+
+/**************************************************************************/
+/*!
+	@brief  Uses a known IIO device
+
+	@param index N of iio:deviceN
+
+	@return 1 on success, -1 if the device does not exist
+*/
+/**************************************************************************/
+int adsIio::openIndex(int index) {
+	close();
+
+	char path[ADS_IIO_PATH_LENGTH * 2];
+	snprintf(path, sizeof(path), "%s/iio:device%d", m_sysfsRoot, index);
+	if (access(path, F_OK) < 0) {
+		fprintf(stderr, "Error while opening %s! Error: %s\n", path, strerror(errno));
+		return -1;
+	}
+
+	m_index = index;
+	memset(m_gains, 0xFF, sizeof(m_gains));
+	memset(m_rates, 0xFF, sizeof(m_rates));
+	return 1;
+}
+
+/**************************************************************************/
+/*!
+	@brief  Stops the buffer and forgets the device
+*/
+/**************************************************************************/
+void adsIio::close() {
+	stopBuffer();
+	m_index = -1;
+}
+
+/**************************************************************************/
+/*!
+	@brief  Checks if a device is in use
+*/
+/**************************************************************************/
+bool adsIio::isOpen() const {
+	return m_index >= 0;
+}
+
+/**************************************************************************/
+/*!
+	@brief  Gets N of iio:deviceN, -1 if closed
+*/
+/**************************************************************************/
+int adsIio::index() const {
+	return m_index;
+}
+
+/**************************************************************************/
+/*!
+	@brief  Writes a sysfs attribute of the device
+
+	@param attribute path relative to the device directory
+	@param value string to write
+
+	@return 1 on success, -1 on error
+*/
+/**************************************************************************/
+int adsIio::writeAttribute(const char* attribute, const char* value) {
+	char path[ADS_IIO_PATH_LENGTH * 2];
+	snprintf(path, sizeof(path), "%s/iio:device%d/%s", m_sysfsRoot, m_index, attribute);
+
+	int fd = ::open(path, O_WRONLY | O_TRUNC);
+	if (fd < 0) {
+		fprintf(stderr, "Error while opening %s! Error: %s\n", path, strerror(errno));
+		return -1;
+	}
+
+	ssize_t rc = write(fd, value, strlen(value));
+	::close(fd);
+	if (rc < 0) {
+		fprintf(stderr, "Error while writing %s to %s! Error: %s\n", value, path, strerror(errno));
+		return -1;
+	}
+
+	return 1;
+}
+
+/**************************************************************************/
+/*!
+	@brief  Reads a sysfs attribute of the device, without the newline
+
+	@param attribute path relative to the device directory
+	@param value output string
+	@param size size of value
+
+	@return 1 on success, -1 on error
+*/
+/**************************************************************************/
+int adsIio::readAttribute(const char* attribute, char* value, size_t size) {
+	char path[ADS_IIO_PATH_LENGTH * 2];
+	snprintf(path, sizeof(path), "%s/iio:device%d/%s", m_sysfsRoot, m_index, attribute);
+
+	int fd = ::open(path, O_RDONLY);
+	if (fd < 0) {
+		fprintf(stderr, "Error while opening %s! Error: %s\n", path, strerror(errno));
+		return -1;
+	}
+
+	ssize_t rc = read(fd, value, size - 1);
+	::close(fd);
+	if (rc < 0) {
+		fprintf(stderr, "Error while reading %s! Error: %s\n", path, strerror(errno));
+		return -1;
+	}
+
+	value[rc] = '\0';
+	char* newline = strchr(value, '\n');
+	if (newline)
+		*newline = '\0';
+	return 1;
+}
+
+/**************************************************************************/
+/*!
+	@brief  Applies the gain and data rate of an input through its scale
+			and sampling_frequency attributes.  Only the attributes that
+			changed since the last call are written.
+
+	@param input ADS_INPUT_* multiplexer setting
+	@param adsType tla2024, ads1015 or ads1115
+	@param gain gain setting
+	@param sps data rate setting
+
+	@return 1 on success, -1 on error
+*/
+/**************************************************************************/
+int adsIio::configure(uint8_t input, uint8_t adsType, adsGain_t gain, adsSps_t sps) {
+	if (m_index < 0 || input >= ADS_INPUT_COUNT)
+		return -1;
+
+	uint8_t rateIndex = (sps & ADS1015_REG_CONFIG_DR_MASK) >> 5;
+	uint16_t rate = adsType == ads1115 ? ads1115Rates[rateIndex] : ads1015Rates[rateIndex];
+	if (m_gains[input] == gain && m_rates[input] == rate)
+		return 1;
+
+	// The attributes cannot change while the buffer runs
+	stopBuffer();
+
+	char attribute[64];
+	char value[32];
+	if (m_gains[input] != gain) {
+		uint8_t gainIndex = (gain & ADS1015_REG_CONFIG_PGA_MASK) >> 9;
+		if (gainIndex > 5)
+			gainIndex = 5;
+
+		// mV per code, rounded up so the driver maps it back to the same range
+		uint8_t bits = adsType == ads1115 ? 15 : 11;
+		uint64_t micro = ((uint64_t)fullScales[gainIndex] * 1000000 + (1 << bits) - 1) >> bits;
+		snprintf(value, sizeof(value), "%u.%06u", (unsigned)(micro / 1000000), (unsigned)(micro % 1000000));
+		snprintf(attribute, sizeof(attribute), "in_%s_scale", channelNames[input]);
+		if (writeAttribute(attribute, value) < 0)
+			return -1;
+		m_gains[input] = gain;
+	}
+
+	if (m_rates[input] != rate) {
+		snprintf(value, sizeof(value), "%u", rate);
+		snprintf(attribute, sizeof(attribute), "in_%s_sampling_frequency", channelNames[input]);
+		if (writeAttribute(attribute, value) < 0)
+			return -1;
+		m_rates[input] = rate;
+	}
+
+	return 1;
+}
+
+/**************************************************************************/
+/*!
+	@brief  Converts an input through its raw attribute (the driver does
+			the single-shot conversion).  Stops the buffer if it runs.
+
+	@param input ADS_INPUT_* multiplexer setting
+	@param value output ADC code, sign extended by the driver
+
+	@return 1 on success, -1 on error
+*/
+/**************************************************************************/
+int adsIio::readRaw(uint8_t input, int16_t* value) {
+	if (m_index < 0 || input >= ADS_INPUT_COUNT)
+		return -1;
+
+	stopBuffer();
+
+	char attribute[64];
+	char raw[32];
+	snprintf(attribute, sizeof(attribute), "in_%s_raw", channelNames[input]);
+	if (readAttribute(attribute, raw, sizeof(raw)) < 0)
+		return -1;
+
+	*value = (int16_t)strtol(raw, NULL, 10);
+	return 1;
+}
+
+/**************************************************************************/
+/*!
+	@brief  Sets the trigger attached when the buffer starts
+
+	@param trigger trigger name (e.g. an hrtimer trigger), NULL to keep
+			the current one
+*/
+/**************************************************************************/
+void adsIio::setTrigger(const char* trigger) {
+	snprintf(m_trigger, sizeof(m_trigger), "%s", trigger ? trigger : "");
+}
+
+/**************************************************************************/
+/*!
+	@brief  Reads the storage format of a scan element, e.g. le:s12/16>>4
+
+	@param channel channel name without the in_ prefix
+	@param element output layout, the offset is left unchanged
+
+	@return 1 on success, -1 on error
+*/
+/**************************************************************************/
+int adsIio::readElementType(const char* channel, element_t* element) {
+	char attribute[64];
+	char type[32];
+	snprintf(attribute, sizeof(attribute), "scan_elements/in_%s_type", channel);
+	if (readAttribute(attribute, type, sizeof(type)) < 0)
+		return -1;
+
+	char endian, sign;
+	unsigned realBits, storageBits, shift;
+	if (sscanf(type, "%ce:%c%u/%u>>%u", &endian, &sign, &realBits, &storageBits, &shift) != 5
+		|| storageBits % 8 || storageBits > 64 || realBits > storageBits) {
+		fprintf(stderr, "Error while parsing the scan type %s of %s!\n", type, channel);
+		return -1;
+	}
+
+	element->bytes = storageBits / 8;
+	element->realBits = realBits;
+	element->shift = shift;
+	element->bigEndian = endian == 'b';
+	element->isSigned = sign == 's';
+	return 1;
+}
+
+/**************************************************************************/
+/*!
+	@brief  Extracts one element of a scan
+
+	@param data first byte of the element
+	@param element layout of the element
+
+	@return the sign extended value
+*/
+/**************************************************************************/
+int64_t adsIio::decode(const uint8_t* data, const element_t& element) const {
+	uint64_t raw = 0;
+	for (uint8_t i = 0; i < element.bytes; i++)
+		raw |= (uint64_t)data[element.bigEndian ? i : element.bytes - 1 - i] << (8 * (element.bytes - 1 - i));
+
+	raw >>= element.shift;
+	if (element.realBits >= 64)
+		return (int64_t)raw;
+
+	raw &= (1ULL << element.realBits) - 1;
+	if (element.isSigned && (raw >> (element.realBits - 1)))
+		raw |= ~0ULL << element.realBits;
+	return (int64_t)raw;
+}
+
+/**************************************************************************/
+/*!
+	@brief  Enables one input and the timestamp as scan elements and
+			starts the triggered buffer.  The watermark is set to rows so
+			a blocking read() returns once a whole block is available.
+
+	@param input ADS_INPUT_* multiplexer setting
+	@param rows scans per block
+
+	@return 1 on success, -1 on error
+*/
+/**************************************************************************/
+int adsIio::startBuffer(uint8_t input, size_t rows) {
+	if (m_index < 0 || input >= ADS_INPUT_COUNT || rows == 0)
+		return -1;
+
+	stopBuffer();
+
+	// The driver converts a single channel per scan
+	char attribute[64];
+	for (uint8_t i = 0; i < ADS_INPUT_COUNT; i++)
+	{
+		snprintf(attribute, sizeof(attribute), "scan_elements/in_%s_en", channelNames[i]);
+		if (writeAttribute(attribute, i == input ? "1" : "0") < 0 && i == input)
+			return -1;
+	}
+	if (readElementType(channelNames[input], &m_value) < 0)
+		return -1;
+	m_value.offset = 0;
+
+	// Kernel timestamps on the same clock as adsTimestampNs()
+	m_hasTimestamp = writeAttribute("scan_elements/in_timestamp_en", "1") > 0
+		&& readElementType("timestamp", &m_timestamp) > 0;
+	if (m_hasTimestamp)
+		writeAttribute("current_timestamp_clock", "monotonic");
+
+	// Every element is aligned to its size, the scan to the largest one
+	m_scanBytes = m_value.bytes;
+	if (m_hasTimestamp) {
+		m_timestamp.offset = (m_scanBytes + m_timestamp.bytes - 1) / m_timestamp.bytes * m_timestamp.bytes;
+		m_scanBytes = m_timestamp.offset + m_timestamp.bytes;
+	}
+
+	if (m_trigger[0] && writeAttribute("trigger/current_trigger", m_trigger) < 0)
+		return -1;
+
+	// Room for the block being read and the next one
+	char value[32];
+	snprintf(value, sizeof(value), "%zu", rows * 2);
+	if (writeAttribute("buffer/length", value) < 0)
+		return -1;
+	snprintf(value, sizeof(value), "%zu", rows);
+	if (writeAttribute("buffer/watermark", value) < 0)
+		return -1;
+
+	char path[ADS_IIO_PATH_LENGTH * 2];
+	snprintf(path, sizeof(path), "%s/iio:device%d", m_devRoot, m_index);
+	m_fd = ::open(path, O_RDONLY);
+	if (m_fd < 0) {
+		fprintf(stderr, "Error while opening %s! Error: %s\n", path, strerror(errno));
+		return -1;
+	}
+
+	if (writeAttribute("buffer/enable", "1") < 0) {
+		::close(m_fd);
+		m_fd = -1;
+		return -1;
+	}
+
+	m_bufferInput = input;
+	return 1;
+}
+
+/**************************************************************************/
+/*!
+	@brief  Disables the buffer, if running
+*/
+/**************************************************************************/
+void adsIio::stopBuffer() {
+	if (m_fd < 0)
+		return;
+
+	writeAttribute("buffer/enable", "0");
+	::close(m_fd);
+	m_fd = -1;
+}
+
+/**************************************************************************/
+/*!
+	@brief  Reads a block of scans from the buffer into a single-channel
+			block, starting the buffer for the block input if needed.
+			Blocks until the rows are available.
+
+	@param block block to fill, its only channel selects the input
+	@param rows scans to read, limited to the block headroom
+
+	@return the number of rows appended
+*/
+/**************************************************************************/
+size_t adsIio::readBlock(adsSampleBlock& block, size_t rows) {
+	if (block.channelCount() != 1)
+		return 0;
+
+	if (rows > block.headroom())
+		rows = block.headroom();
+	if (rows == 0)
+		return 0;
+
+	if (m_fd < 0 || m_bufferInput != block.input(0))
+		if (startBuffer(block.input(0), rows) < 0)
+			return 0;
+
+	// With the watermark the first read() normally returns the whole block
+	size_t wanted = rows * m_scanBytes;
+	size_t got = 0;
+	if (m_scans.size() < wanted)
+		m_scans.resize(wanted);
+	while (got < wanted)
+	{
+		ssize_t rc = read(m_fd, &m_scans[got], wanted - got);
+		if (rc < 0) {
+			if (errno == EINTR)
+				continue;
+
+			fprintf(stderr, "Error while reading the IIO buffer! Error: %s\n", strerror(errno));
+			break;
+		}
+		if (rc == 0)
+			break;
+		got += rc;
+	}
+
+	size_t scans = got / m_scanBytes;
+	for (size_t i = 0; i < scans; i++)
+	{
+		const uint8_t* scan = &m_scans[i * m_scanBytes];
+		int16_t value = (int16_t)decode(scan + m_value.offset, m_value);
+		uint64_t timestampNs = m_hasTimestamp ? (uint64_t)decode(scan + m_timestamp.offset, m_timestamp) : adsTimestampNs();
+		block.appendRow(&value, timestampNs);
+	}
+
+	return scans;
+}
+
+/**************************************************************************/
+/*!
+	@brief  Gets the size of one scan in the buffer, 0 before startBuffer()
+*/
+/**************************************************************************/
+size_t adsIio::scanBytes() const {
+	return m_scanBytes;
+}
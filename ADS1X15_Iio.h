@@ -0,0 +1,100 @@
+/**************************************************************************/
+/*!
+    @file     ADS1X15_Iio.h
+
+    Linux IIO transport for the chips bound to the mainline ti-ads1015
+    kernel driver.
+
+    Attach it to a device with TLA2024::setIio(): the readADC_* calls then
+    go through the sysfs raw attributes instead of i2c-dev (the address is
+    owned by the kernel driver), with the gain and data rate applied
+    through the per-channel scale and sampling_frequency attributes.
+
+    adsReadBlock() on a single-channel block uses the triggered buffer:
+    the scan elements, buffer length and watermark are set once, then each
+    block is read from /dev/iio:deviceN in one read() with the kernel
+    timestamps (switched to CLOCK_MONOTONIC).  The scan rate is the rate
+    of the IIO trigger (e.g. an hrtimer trigger), see setTrigger().
+
+    The kernel driver converts one channel per scan, and the comparator
+    stays on the i2c-dev transport.
+
+    The sysfs and /dev roots can be changed to run against a directory
+    tree that mimics them.
+
+    @section license License
+
+    BSD license, all text here must be included in any redistribution
+*/
+/**************************************************************************/
+
+#ifndef ADS1X15_IIO_H
+#define ADS1X15_IIO_H
+
+#include <vector>
+
+#include "ADS1X15_SampleBlock.h"
+
+/*=========================================================================
+    IIO SETTINGS
+    -----------------------------------------------------------------------*/
+#define ADS_IIO_SYSFS_ROOT     "/sys/bus/iio/devices" ///< IIO devices in sysfs
+#define ADS_IIO_DEV_ROOT       "/dev"                 ///< IIO character devices
+#define ADS_IIO_PATH_LENGTH    (256)                  ///< Maximum sysfs path length
+#define ADS_IIO_SCAN_TIMESTAMP (ADS_INPUT_COUNT)      ///< Scan index of the timestamp, inputs use their ADS_INPUT_*
+/*=========================================================================*/
+
+/**************************************************************************/
+/*!
+    @brief  IIO device of one chip: sysfs attributes and buffered reads
+*/
+/**************************************************************************/
+class adsIio {
+public:
+    adsIio(const char* sysfsRoot = ADS_IIO_SYSFS_ROOT, const char* devRoot = ADS_IIO_DEV_ROOT);
+    ~adsIio();
+    int    open(const char* i2cDeviceName, uint8_t i2cAddress);
+    int    openIndex(int index);
+    void   close(void);
+    bool   isOpen(void) const;
+    int    index(void) const;
+    int    configure(uint8_t input, uint8_t adsType, adsGain_t gain, adsSps_t sps);
+    int    readRaw(uint8_t input, int16_t* value);
+    void   setTrigger(const char* trigger);
+    int    startBuffer(uint8_t input, size_t rows);
+    void   stopBuffer(void);
+    size_t readBlock(adsSampleBlock& block, size_t rows);
+    size_t scanBytes(void) const;
+
+private:
+    /** Layout of one buffer element, from scan_elements/<channel>_type */
+    typedef struct {
+        size_t  offset;    ///< byte offset in the scan
+        uint8_t bytes;     ///< storage bytes
+        uint8_t realBits;
+        uint8_t shift;
+        bool    bigEndian;
+        bool    isSigned;
+    } element_t;
+
+    int  writeAttribute(const char* attribute, const char* value);
+    int  readAttribute(const char* attribute, char* value, size_t size);
+    int  readElementType(const char* channel, element_t* element);
+    int64_t decode(const uint8_t* data, const element_t& element) const;
+
+    char      m_sysfsRoot[ADS_IIO_PATH_LENGTH];
+    char      m_devRoot[ADS_IIO_PATH_LENGTH];
+    char      m_trigger[ADS_IIO_PATH_LENGTH];
+    int       m_index;                      ///< N of iio:deviceN, -1 if closed
+    int       m_fd;                         ///< character device while the buffer runs
+    uint8_t   m_bufferInput;
+    element_t m_value;
+    element_t m_timestamp;
+    bool      m_hasTimestamp;
+    size_t    m_scanBytes;
+    std::vector<uint8_t> m_scans;
+    uint16_t  m_gains[ADS_INPUT_COUNT];     ///< scale written per input, 0xFFFF if unknown
+    uint16_t  m_rates[ADS_INPUT_COUNT];     ///< sampling_frequency written per input, 0xFFFF if unknown
+};
+
+#endif // ADS1X15_IIO_H
@@ -0,0 +1,408 @@
+/**************************************************************************/
+/*!
+	@file     ADS1X15_Planner.cpp
+
+	Bus-speed-aware acquisition planner.
+
+	@section license License
+
+	BSD license, all text here must be included in any redistribution
+*/
+/**************************************************************************/
+
+#include <math.h>
+
+#include "ADS1X15_Planner.h"
+
+/// Data rate settings from the slowest to the fastest, for every chip
+static const adsSps_t rateSettings[] = { SPS_128, SPS_250, SPS_490, SPS_920, SPS_1600, SPS_2400, SPS_3300, SPS_860 };
+
+/**************************************************************************/
+/*!
+	@brief  Instantiates an empty planner
+*/
+/**************************************************************************/
+adsPlanner::adsPlanner()
+{
+	m_accessCostUs = ADS_PLAN_ACCESS_COST;
+	m_planned = false;
+	memset(&m_report, 0, sizeof(m_report));
+}
+
+/**************************************************************************/
+/*!
+	@brief  Adds an input with its target rate
+
+	@param device device of the input, must outlive the planner
+	@param input ADS_INPUT_* multiplexer setting
+	@param rateHz conversions per second
+
+	@return 1 on success, -1 on error
+*/
+/**************************************************************************/
+int adsPlanner::addInput(TLA2024* device, uint8_t input, double rateHz) {
+	if (!device || input >= ADS_INPUT_COUNT || rateHz <= 0)
+		return -1;
+
+	if (!findBus(device->getI2cDeviceName()))
+		return -1;
+
+	device_t* entry = NULL;
+	for (size_t i = 0; i < m_devices.size(); i++)
+		if (m_devices[i].device == device)
+			entry = &m_devices[i];
+
+	if (!entry) {
+		device_t added;
+		added.device = device;
+		added.rateHz = 0;
+		added.maxRateHz = 0;
+		memset(&added.plan, 0, sizeof(added.plan));
+		m_devices.push_back(added);
+		entry = &m_devices.back();
+	}
+
+	entry->inputs.push_back(input);
+	entry->rateHz += rateHz;
+	if (rateHz > entry->maxRateHz)
+		entry->maxRateHz = rateHz;
+	m_planned = false;
+
+	return 1;
+}
+
+/**************************************************************************/
+/*!
+	@brief  Sets the clock of a bus
+
+	@param i2cDeviceName I2C device name of the bus
+	@param clockHz SCL frequency, e.g. ADS_BUS_CLOCK_FAST
+
+	@return 1 on success, -1 on error
+*/
+/**************************************************************************/
+int adsPlanner::setBusClock(const char* i2cDeviceName, uint32_t clockHz) {
+	bus_t* bus = findBus(i2cDeviceName);
+	if (!bus || !clockHz)
+		return -1;
+
+	bus->clockHz = clockHz;
+	m_planned = false;
+	return 1;
+}
+
+/**************************************************************************/
+/*!
+	@brief  Reads the clock of a bus from the clock-frequency property of
+			its device tree node and sets it
+
+	@param i2cDeviceName I2C device name of the bus, e.g. /dev/i2c-1
+
+	@return the clock in Hz, 0 if the bus has no such property (the clock
+			is then unchanged)
+*/
+/**************************************************************************/
+uint32_t adsPlanner::queryBusClock(const char* i2cDeviceName) {
+	if (!i2cDeviceName)
+		return 0;
+
+	const char* adapter = strrchr(i2cDeviceName, '/');
+	adapter = adapter ? adapter + 1 : i2cDeviceName;
+
+	char path[128];
+	snprintf(path, sizeof(path), "/sys/class/i2c-adapter/%s/of_node/clock-frequency", adapter);
+	int fd = open(path, O_RDONLY);
+	if (fd < 0)
+		return 0;
+
+	// Device tree cells are big-endian
+	unsigned char cell[4];
+	ssize_t rc = read(fd, cell, sizeof(cell));
+	close(fd);
+	if (rc != sizeof(cell))
+		return 0;
+
+	uint32_t clockHz = ((uint32_t)cell[0] << 24) | ((uint32_t)cell[1] << 16) | ((uint32_t)cell[2] << 8) | cell[3];
+	if (setBusClock(i2cDeviceName, clockHz) < 0)
+		return 0;
+
+	return clockHz;
+}
+
+/**************************************************************************/
+/*!
+	@brief  Measures the kernel time of a register access on a device: the
+			time of repeated OS bit reads less their transfer time at the
+			bus clock.  The bus clock must be set first.
+
+	@param device device to read, it must answer
+	@param accesses number of reads to average
+
+	@return 1 on success, -1 on error
+*/
+/**************************************************************************/
+int adsPlanner::measure(TLA2024* device, size_t accesses) {
+	if (!device || !accesses)
+		return -1;
+
+	if (device->getIio()) {
+		fprintf(stderr, "Error while measuring the bus! The device is driven through IIO\n");
+		return -1;
+	}
+
+	bus_t* bus = findBus(device->getI2cDeviceName());
+	if (!bus)
+		return -1;
+
+	// Leaves the pointer on the config register, the next reads are bare
+	device->isConversionReady();
+
+	uint64_t start = adsTimestampNs();
+	for (size_t i = 0; i < accesses; i++)
+		device->isConversionReady();
+	uint64_t elapsed = adsTimestampNs() - start;
+
+	if (!device->isAvailable()) {
+		fprintf(stderr, "Error while measuring the bus! The device 0x%02x does not answer\n", device->getI2cAddress());
+		return -1;
+	}
+
+	double costUs = elapsed / 1000.0 / accesses - transferUs(bus->clockHz, 3, 1);
+	m_accessCostUs = costUs > 1 ? (uint32_t)(costUs + 0.5) : 1;
+	m_planned = false;
+
+	return 1;
+}
+
+/**************************************************************************/
+/*!
+	@brief  Sets the kernel time of a register access (open, ioctl,
+			read/write, close)
+
+	@param costUs time per access in uS
+*/
+/**************************************************************************/
+void adsPlanner::setAccessCost(uint32_t costUs) {
+	m_accessCostUs = costUs;
+	m_planned = false;
+}
+
+/**************************************************************************/
+/*!
+	@brief  Gets the kernel time of a register access in uS
+*/
+/**************************************************************************/
+uint32_t adsPlanner::getAccessCost() const {
+	return m_accessCostUs;
+}
+
+/**************************************************************************/
+/*!
+	@brief  Plans every chip, then checks the load of every bus
+
+	@return 1 if every rate can be met, -1 otherwise (the report tells by
+			how much)
+*/
+/**************************************************************************/
+int adsPlanner::plan() {
+	memset(&m_report, 0, sizeof(m_report));
+	m_report.feasible = !m_devices.empty();
+	for (size_t b = 0; b < m_buses.size(); b++)
+		m_buses[b].busyUs = 0;
+
+	double maxRateHz = 0;
+	double cpuUs = 0;
+	for (size_t i = 0; i < m_devices.size(); i++)
+	{
+		device_t* device = &m_devices[i];
+		bus_t* bus = findBus(device->device->getI2cDeviceName());
+		if (planDevice(device, bus) < 0)
+			m_report.feasible = false;
+
+		// Continuous: one access and one pacing wakeup per sample.
+		// Single-shot: config write, OS poll and conversion read, with a
+		// wakeup after the conversion delay and one after the poll delay.
+		double rate = device->plan.scanRateHz;
+		size_t accesses = device->plan.continuous ? 1 : 3;
+		size_t wakeups = device->plan.continuous ? 1 : 2;
+		m_report.accessesPerSecond += rate * accesses;
+		cpuUs += rate * (accesses * m_accessCostUs + wakeups * ADS_PLAN_WAKEUP_COST);
+
+		if (device->maxRateHz > maxRateHz)
+			maxRateHz = device->maxRateHz;
+	}
+
+	for (size_t b = 0; b < m_buses.size(); b++)
+	{
+		double load = m_buses[b].busyUs / 1000000.0;
+		if (load > m_report.busLoad)
+			m_report.busLoad = load;
+		if (load > ADS_RATE_MAX_UTILIZATION) {
+			fprintf(stderr, "The requested rates cannot be met, the bus %s would be %d%% busy!\n",
+				m_buses[b].name, (int)(load * 100));
+			m_report.feasible = false;
+		}
+	}
+	m_report.busHeadroom = m_report.busLoad < 1 ? 1 - m_report.busLoad : 0;
+
+	// A row per conversion of the fastest input
+	m_report.batchRows = (uint32_t)ceil(maxRateHz / ADS_PLAN_MAX_WAKEUPS);
+	if (m_report.batchRows < 1)
+		m_report.batchRows = 1;
+	cpuUs += maxRateHz / m_report.batchRows * ADS_PLAN_WAKEUP_COST;
+	m_report.cpuLoad = cpuUs / 1000000.0;
+
+	m_planned = true;
+	return m_report.feasible ? 1 : -1;
+}
+
+/**************************************************************************/
+/*!
+	@brief  Sets the planned data rates and starts the continuous
+			conversions.  Chips in single-shot mode leave continuous mode
+			with their next conversion.
+
+	@return 1 on success, -1 if the plan is missing or not feasible
+*/
+/**************************************************************************/
+int adsPlanner::apply() {
+	if (!m_planned || !m_report.feasible)
+		return -1;
+
+	for (size_t i = 0; i < m_devices.size(); i++)
+	{
+		device_t* device = &m_devices[i];
+		device->device->setSps(device->plan.sps);
+		if (device->plan.continuous)
+			device->device->startADC_Continuous(device->inputs[0]);
+	}
+
+	return 1;
+}
+
+/**************************************************************************/
+/*!
+	@brief  Gets the expected load of the last plan
+*/
+/**************************************************************************/
+adsPlanReport_t adsPlanner::report() const {
+	return m_report;
+}
+
+/**************************************************************************/
+/*!
+	@brief  Gets the plan of one chip, zeroed if it has no input
+*/
+/**************************************************************************/
+adsPlanDevice_t adsPlanner::devicePlan(TLA2024* device) const {
+	adsPlanDevice_t plan;
+	memset(&plan, 0, sizeof(plan));
+	for (size_t i = 0; i < m_devices.size(); i++)
+		if (m_devices[i].device == device)
+			plan = m_devices[i].plan;
+
+	return plan;
+}
+
+/**************************************************************************/
+/*!
+	@brief  Finds or adds a bus, new buses run at ADS_BUS_CLOCK_STANDARD
+
+	@return the bus, NULL if the name is too long
+*/
+/**************************************************************************/
+adsPlanner::bus_t* adsPlanner::findBus(const char* i2cDeviceName) {
+	if (!i2cDeviceName || strlen(i2cDeviceName) >= ADS_PLAN_NAME_LENGTH)
+		return NULL;
+
+	for (size_t i = 0; i < m_buses.size(); i++)
+		if (!strcmp(m_buses[i].name, i2cDeviceName))
+			return &m_buses[i];
+
+	bus_t bus;
+	strcpy(bus.name, i2cDeviceName);
+	bus.clockHz = ADS_BUS_CLOCK_STANDARD;
+	bus.busyUs = 0;
+	m_buses.push_back(bus);
+	return &m_buses.back();
+}
+
+/**************************************************************************/
+/*!
+	@brief  Gets the bus time of transfers: 9 clocks per byte with the
+			address byte, plus START and STOP.  High-speed transfers are
+			preceded by the master code at the fast mode clock.
+
+	@param clockHz bus clock
+	@param bytes bytes of all the transfers, address bytes included
+	@param transfers number of transfers (each ends with a STOP)
+
+	@return the time in uS
+*/
+/**************************************************************************/
+double adsPlanner::transferUs(uint32_t clockHz, size_t bytes, size_t transfers) const {
+	double us = (bytes * 9.0 + transfers * 2.0) * 1000000.0 / clockHz;
+	if (clockHz > ADS_BUS_CLOCK_FAST)
+		us += transfers * (9.0 + 2.0) * 1000000.0 / ADS_BUS_CLOCK_FAST;
+
+	return us;
+}
+
+/**************************************************************************/
+/*!
+	@brief  Picks the mode and the slowest data rate that keep up with
+			the inputs of a chip, and adds its transfers to its bus
+
+	@return 1 on success, -1 if no data rate keeps up (the plan then holds
+			the fastest data rate)
+*/
+/**************************************************************************/
+int adsPlanner::planDevice(device_t* device, bus_t* bus) {
+	adsPlanDevice_t* plan = &device->plan;
+	TLA2024* chip = device->device;
+	adsSps_t previous = chip->getSps();
+
+	// Continuous mode only pays off when the multiplexer never switches
+	plan->continuous = device->inputs.size() == 1 && !chip->getIio();
+	plan->scanRateHz = device->rateHz;
+
+	// Continuous: bare read of the conversion register (address, 2 bytes).
+	// Single-shot: config write (4), bare OS poll (3), pointer write (2)
+	// and conversion read (3).
+	double wireUs = plan->continuous ? transferUs(bus->clockHz, 3, 1) : transferUs(bus->clockHz, 12, 4);
+	double overheadUs = wireUs + (plan->continuous ? 1 : 3) * m_accessCostUs;
+	plan->busOverheadUs = (uint32_t)ceil(overheadUs);
+	bus->busyUs += device->rateHz * wireUs;
+
+	// Share of the time the driver spends reading the chip
+	double driverLoad = device->rateHz * overheadUs / 1000000.0;
+
+	int rc = -1;
+	for (size_t r = 0; r < sizeof(rateSettings) / sizeof(rateSettings[0]) && rc < 0; r++)
+	{
+		chip->setSps(rateSettings[r]);
+		plan->sps = rateSettings[r];
+
+		if (plan->continuous) {
+			// Each read must see a new result, the conversion delay has a
+			// 100 uS margin over the data rate
+			plan->converterLoad = device->rateHz * (chip->getConversionDelay() - 100) / 1000000.0;
+			if (plan->converterLoad <= 1 && driverLoad <= ADS_RATE_MAX_UTILIZATION)
+				rc = 1;
+		}
+		else {
+			plan->converterLoad = device->rateHz * chip->getConversionDelay() / 1000000.0 + driverLoad;
+			if (plan->converterLoad <= ADS_RATE_MAX_UTILIZATION)
+				rc = 1;
+		}
+	}
+
+	if (rc < 0) {
+		double busy = plan->continuous && driverLoad > plan->converterLoad ? driverLoad : plan->converterLoad;
+		fprintf(stderr, "The requested rates of the chip 0x%02x cannot be met, it would be %d%% busy at the fastest data rate!\n",
+			chip->getI2cAddress(), (int)(busy * 100));
+	}
+
+	chip->setSps(previous);
+	return rc;
+}
@@ -0,0 +1,118 @@
+/**************************************************************************/
+/*!
+    @file     ADS1X15_Planner.h
+
+    Bus-speed-aware acquisition planner.
+
+    The achievable rate of an input depends on the conversion time of the
+    data rate and on the I2C time of the register accesses, which depends
+    on the bus clock (100 kHz, 400 kHz, 3.4 MHz) and on the kernel time of
+    each access (open, ioctl, read/write, close on i2c-dev).
+
+    Given the inputs of every chip and their target rates, plan() picks
+    for each chip:
+      - continuous mode when the chip has a single input: one 3-byte read
+        of the conversion register per sample,
+      - single-shot conversions otherwise: config write, OS poll and
+        conversion read, 12 bytes and 3 accesses per sample,
+      - the slowest data rate (least noise) that keeps up,
+    and the rows per sample block so the application handles at most
+    ADS_PLAN_MAX_WAKEUPS blocks per second. report() gives the expected
+    bus load and headroom of the busiest bus and the CPU load.
+
+    Each byte takes 9 clocks (8 bits and the acknowledge); high-speed
+    accesses start with a master code at 400 kHz. The bus clock can be
+    set, or read from the device tree (queryBusClock()), it is
+    ADS_BUS_CLOCK_STANDARD otherwise. The kernel time per access can be
+    measured on a device (measure()).
+
+    @section license License
+
+    BSD license, all text here must be included in any redistribution
+*/
+/**************************************************************************/
+
+#ifndef ADS1X15_PLANNER_H
+#define ADS1X15_PLANNER_H
+
+#include <vector>
+
+#include "ADS1X15_RateScheduler.h"
+
+/*=========================================================================
+    PLANNER SETTINGS
+    -----------------------------------------------------------------------*/
+#define ADS_BUS_CLOCK_STANDARD  (100000)  ///< Standard mode bus clock in Hz
+#define ADS_BUS_CLOCK_FAST      (400000)  ///< Fast mode bus clock in Hz
+#define ADS_BUS_CLOCK_HIGHSPEED (3400000) ///< High-speed mode bus clock in Hz
+#define ADS_PLAN_ACCESS_COST    (40)      ///< Default kernel time per register access in uS
+#define ADS_PLAN_WAKEUP_COST    (10)      ///< CPU time per thread wakeup in uS
+#define ADS_PLAN_MAX_WAKEUPS    (100)     ///< Sample blocks per second the batching aims for
+#define ADS_PLAN_NAME_LENGTH    (64)      ///< Maximum I2C device name length
+/*=========================================================================*/
+
+/** Plan of one chip */
+typedef struct {
+    adsSps_t sps;           ///< data rate to set
+    bool     continuous;    ///< continuous mode on its single input
+    double   scanRateHz;    ///< conversions per second over all its inputs
+    double   converterLoad; ///< share of the converter time used
+    uint32_t busOverheadUs; ///< I2C and kernel time per conversion, see adsRateScheduler::setBusOverhead()
+} adsPlanDevice_t;
+
+/** Expected load of the whole plan */
+typedef struct {
+    bool     feasible;          ///< every rate is met
+    double   busLoad;           ///< share of the busiest bus used by the transfers
+    double   busHeadroom;       ///< share of the busiest bus left
+    double   cpuLoad;           ///< share of one core spent in accesses and wakeups
+    double   accessesPerSecond; ///< register accesses over all buses
+    uint32_t batchRows;         ///< rows per sample block
+} adsPlanReport_t;
+
+/**************************************************************************/
+/*!
+    @brief  Picks data rates, modes and batching for target input rates
+*/
+/**************************************************************************/
+class adsPlanner {
+public:
+    adsPlanner();
+    int      addInput(TLA2024* device, uint8_t input, double rateHz);
+    int      setBusClock(const char* i2cDeviceName, uint32_t clockHz);
+    uint32_t queryBusClock(const char* i2cDeviceName);
+    int      measure(TLA2024* device, size_t accesses = 200);
+    void     setAccessCost(uint32_t costUs);
+    uint32_t getAccessCost(void) const;
+    int      plan(void);
+    int      apply(void);
+    adsPlanReport_t report(void) const;
+    adsPlanDevice_t devicePlan(TLA2024* device) const;
+
+private:
+    typedef struct {
+        char     name[ADS_PLAN_NAME_LENGTH];
+        uint32_t clockHz;
+        double   busyUs;  ///< transfer time per second of the last plan
+    } bus_t;
+
+    typedef struct {
+        TLA2024*             device;
+        std::vector<uint8_t> inputs;
+        double               rateHz;    ///< sum of the input rates
+        double               maxRateHz; ///< fastest input
+        adsPlanDevice_t      plan;
+    } device_t;
+
+    bus_t*   findBus(const char* i2cDeviceName);
+    double   transferUs(uint32_t clockHz, size_t bytes, size_t transfers) const;
+    int      planDevice(device_t* device, bus_t* bus);
+
+    std::vector<device_t> m_devices;
+    std::vector<bus_t>    m_buses;
+    uint32_t              m_accessCostUs;
+    bool                  m_planned;
+    adsPlanReport_t       m_report;
+};
+
+#endif // ADS1X15_PLANNER_H
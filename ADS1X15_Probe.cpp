@@ -0,0 +1,319 @@
+/**************************************************************************/
+/*!
+	@file     ADS1X15_Probe.cpp
+
+	Bus discovery and chip-type auto-detection for the ADS1015, ADS1115
+	and TLA2024.
+
+	@section license License
+
+	BSD license, all text here must be included in any redistribution
+*/
+/**************************************************************************/
+
+#include <thread>
+#include <time.h>
+
+#include "ADS1X15_Probe.h"
+
+/// Config written for the reserved bits test: reset default without the OS bit
+#define ADS_PROBE_IDLECONFIG                                                     \
+	(ADS1015_REG_CONFIG_MUX_DIFF_0_1 | ADS1015_REG_CONFIG_PGA_2_048V |             \
+	 ADS1015_REG_CONFIG_MODE_SINGLE | ADS1015_REG_CONFIG_DR_1600SPS |             \
+	 ADS1015_REG_CONFIG_CQUE_NONE)
+
+/// Lo_thresh reset value, never written by the library
+#define ADS_PROBE_LOTHRESH       (0x8000)
+/// Hi_thresh reset value of the ADS1115
+#define ADS_PROBE_HITHRESH_16BIT (0x7FFF)
+/// Hi_thresh reset value of the ADS1015, the 4 LSBs read 0
+#define ADS_PROBE_HITHRESH_12BIT (0x7FF0)
+
+/// Comparator bits written to detect the TLA2024 reserved bits
+#define ADS_PROBE_RESERVEDTEST                                                   \
+	(ADS1015_REG_CONFIG_CMODE_WINDOW | ADS1015_REG_CONFIG_CQUE_2CONV)
+
+/// Mask of the comparator bits, reserved on the TLA2024
+#define ADS_PROBE_RESERVEDMASK                                                   \
+	(ADS1015_REG_CONFIG_CMODE_MASK | ADS1015_REG_CONFIG_CPOL_MASK |              \
+	 ADS1015_REG_CONFIG_CLAT_MASK | ADS1015_REG_CONFIG_CQUE_MASK)
+
+static const uint8_t probeAddresses[] = { I2CADDRESS_1, I2CADDRESS_2, I2CADDRESS_4, I2CADDRESS_3 };
+
+/**************************************************************************/
+/*!
+	@brief  Monotonic time in microseconds
+*/
+/**************************************************************************/
+static uint64_t probeTimeUs(void) {
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+/**************************************************************************/
+/*!
+	@brief  Writes 16-bits to a register, single attempt and silent
+
+	@return true if the device acknowledged the write
+*/
+/**************************************************************************/
+static bool probeWrite(int fd, uint8_t reg, uint16_t value) {
+	unsigned char buf[3] = { reg, (uint8_t)(value >> 8), (uint8_t)(value & 0xFF) };
+	return write(fd, buf, 3) == 3;
+}
+
+/**************************************************************************/
+/*!
+	@brief  Reads 16-bits from a register, single attempt and silent
+
+	@return true if the device acknowledged the read
+*/
+/**************************************************************************/
+static bool probeRead(int fd, uint8_t reg, uint16_t* value) {
+	unsigned char buf[2] = { reg };
+	if (write(fd, buf, 1) != 1)
+		return false;
+	if (read(fd, buf, 2) != 2)
+		return false;
+
+	*value = (uint16_t)((buf[0] << 8) | buf[1]);
+	return true;
+}
+
+/**************************************************************************/
+/*!
+	@brief  Runs one single-shot conversion at the fastest data rate
+
+	@param fd bus file descriptor with the slave address set
+	@param code conversion register read after the conversion
+	@param elapsed conversion time in uS
+
+	@return true if the conversion completed
+*/
+/**************************************************************************/
+static bool probeConversion(int fd, uint16_t* code, uint64_t* elapsed) {
+	uint16_t config =
+		ADS1015_REG_CONFIG_OS_SINGLE |
+		ADS1015_REG_CONFIG_MUX_SINGLE_0 |
+		ADS1015_REG_CONFIG_PGA_0_256V |   // Highest gain shows the most LSB noise
+		ADS1015_REG_CONFIG_MODE_SINGLE |
+		ADS1115_REG_CONFIG_DR_860SPS |    // 860 SPS on ADS1115, 3300 SPS on 12-bit parts
+		ADS1015_REG_CONFIG_CQUE_NONE;
+
+	if (!probeWrite(fd, ADS1015_REG_POINTER_CONFIG, config))
+		return false;
+
+	uint64_t start = probeTimeUs();
+	uint16_t status;
+	do {
+		if (!probeRead(fd, ADS1015_REG_POINTER_CONFIG, &status))
+			return false;
+		*elapsed = probeTimeUs() - start;
+		if (*elapsed > ADS_PROBE_TIMEOUT)
+			return false;
+	} while (ADS1015_REG_CONFIG_OS_BUSY == (status & ADS1015_REG_CONFIG_OS_MASK));
+
+	return probeRead(fd, ADS1015_REG_POINTER_CONVERT, code);
+}
+
+/**************************************************************************/
+/*!
+	@brief  Checks the register signature of an ADS1x15/TLA2024 without
+			writing to the device
+
+	Other parts share the 0x48..0x4B addresses (LM75, TMP102, PCF8591...)
+	and must not be written to. A device is accepted if:
+	- the config reserved bits read 03h (TLA2024, or ADS1x15 with the
+	  comparator disabled as out of reset), or
+	- otherwise (ADS1x15 only, the TLA2024 has no threshold registers),
+	  Lo_thresh holds its reset value 8000h and either Hi_thresh holds its
+	  reset value or the comparator is enabled (startComparator_SingleEnded()
+	  only writes Hi_thresh).
+	An ADS1x15 whose Lo_thresh was changed by another program with the
+	comparator disabled is not detected.
+
+	@param fd bus file descriptor with the slave address set
+	@param config config register read
+
+	@return true if the registers match
+*/
+/**************************************************************************/
+static bool probeSignature(int fd, uint16_t* config) {
+	// Absent devices NACK the pointer write
+	uint16_t loThresh, hiThresh;
+	if (!probeRead(fd, ADS1015_REG_POINTER_CONFIG, config))
+		return false;
+	if ((*config & ADS_PROBE_RESERVEDMASK) == TLA2024_REG_RESERVED)
+		return true;
+
+	// The TLA2024 has no threshold registers and may NACK them
+	if (!probeRead(fd, ADS1015_REG_POINTER_LOWTHRESH, &loThresh))
+		return false;
+	if (!probeRead(fd, ADS1015_REG_POINTER_HITHRESH, &hiThresh))
+		return false;
+	if (loThresh != ADS_PROBE_LOTHRESH)
+		return false;
+
+	return hiThresh == ADS_PROBE_HITHRESH_16BIT || hiThresh == ADS_PROBE_HITHRESH_12BIT
+		|| (*config & ADS1015_REG_CONFIG_CQUE_MASK) != ADS1015_REG_CONFIG_CQUE_NONE;
+}
+
+/**************************************************************************/
+/*!
+	@brief  Probes a single address and identifies the chip
+
+	@param fd bus file descriptor
+	@param i2cAddress I2C address to probe
+	@param adsType detected chip type
+
+	@return true if an ADS1x15/TLA2024 answered at the address
+*/
+/**************************************************************************/
+static bool probeAddress(int fd, uint8_t i2cAddress, uint8_t* adsType) {
+	if (ioctl(fd, I2C_SLAVE, i2cAddress) < 0)
+		return false;
+
+	// Read-only checks first, nothing is written to other parts
+	uint16_t config;
+	if (!probeSignature(fd, &config))
+		return false;
+
+	// The TLA2024 ignores writes to the comparator bits, they read back 03h
+	uint16_t reserved = 0;
+	if (!probeWrite(fd, ADS1015_REG_POINTER_CONFIG,
+		(ADS_PROBE_IDLECONFIG & ~ADS_PROBE_RESERVEDMASK) | ADS_PROBE_RESERVEDTEST))
+		return false;
+	if (!probeRead(fd, ADS1015_REG_POINTER_CONFIG, &reserved))
+		return false;
+	reserved &= ADS_PROBE_RESERVEDMASK;
+
+	// 12-bit parts always return 0 in the 4 LSBs, and are ~4x faster at DR=111
+	bool lsbSeen = false;
+	uint64_t fastest = ADS_PROBE_TIMEOUT;
+	for (size_t i = 0; i < ADS_PROBE_SAMPLES; i++)
+	{
+		uint16_t code;
+		uint64_t elapsed;
+		if (!probeConversion(fd, &code, &elapsed))
+		{
+			probeWrite(fd, ADS1015_REG_POINTER_CONFIG, config & ~ADS1015_REG_CONFIG_OS_MASK);
+			return false;
+		}
+
+		if (code & 0x000F)
+			lsbSeen = true;
+		if (elapsed < fastest)
+			fastest = elapsed;
+	}
+
+	// Give the device its settings back, without starting a conversion
+	probeWrite(fd, ADS1015_REG_POINTER_CONFIG, config & ~ADS1015_REG_CONFIG_OS_MASK);
+
+	if (lsbSeen || fastest > ADS_PROBE_12BIT_MAXDELAY)
+		*adsType = ads1115;
+	else if (reserved == TLA2024_REG_RESERVED)
+		*adsType = tla2024;
+	else
+		*adsType = ads1015;
+
+	return true;
+}
+
+/**************************************************************************/
+/*!
+	@brief  Probes every valid address of one bus
+
+	@param i2cDeviceName I2C device name
+	@param results devices found on the bus
+*/
+/**************************************************************************/
+static void probeBus(const char* i2cDeviceName, std::vector<adsProbeResult_t>* results) {
+	// A missing bus is not retried, this is not a transient error
+	int fd = open(i2cDeviceName, O_RDWR);
+	if (fd < 0)
+		return;
+
+	for (size_t i = 0; i < sizeof(probeAddresses); i++)
+	{
+		adsProbeResult_t result;
+		result.i2cDeviceName = i2cDeviceName;
+		result.i2cAddress = probeAddresses[i];
+		if (probeAddress(fd, result.i2cAddress, &result.adsType))
+			results->push_back(result);
+	}
+
+	close(fd);
+}
+
+/**************************************************************************/
+/*!
+	@brief  Scans the buses in parallel for ADS1015/ADS1115/TLA2024 chips
+
+	@param i2cDeviceNames I2C device names, must outlive the results
+	@param busCount number of I2C device names
+	@param results devices found, in bus then address order
+
+	@return the number of devices found
+*/
+/**************************************************************************/
+size_t adsProbe(const char* const* i2cDeviceNames, size_t busCount,
+	std::vector<adsProbeResult_t>& results) {
+	std::vector<std::vector<adsProbeResult_t> > perBus(busCount);
+	std::vector<std::thread> threads;
+
+	for (size_t i = 0; i < busCount; i++)
+		threads.push_back(std::thread(probeBus, i2cDeviceNames[i], &perBus[i]));
+
+	size_t found = 0;
+	for (size_t i = 0; i < busCount; i++)
+	{
+		threads[i].join();
+		results.insert(results.end(), perBus[i].begin(), perBus[i].end());
+		found += perBus[i].size();
+	}
+
+	return found;
+}
+
+/**************************************************************************/
+/*!
+	@brief  Instantiates the driver class matching a probe result
+
+	@param result probe result
+
+	@return a new driver, to be deleted by the caller
+*/
+/**************************************************************************/
+TLA2024* adsCreate(const adsProbeResult_t& result) {
+	switch (result.adsType) {
+	case ads1115:
+		return new ADS1115(result.i2cDeviceName, result.i2cAddress);
+	case ads1015:
+		return new ADS1015(result.i2cDeviceName, result.i2cAddress);
+	default:
+		return new TLA2024(result.i2cDeviceName, result.i2cAddress);
+	}
+}
+
+/**************************************************************************/
+/*!
+	@brief  Scans the buses and instantiates a driver for each device found
+
+	@param i2cDeviceNames I2C device names, must outlive the drivers
+	@param busCount number of I2C device names
+	@param devices new drivers, to be deleted by the caller
+
+	@return the number of devices found
+*/
+/**************************************************************************/
+size_t adsProbeDevices(const char* const* i2cDeviceNames, size_t busCount,
+	std::vector<TLA2024*>& devices) {
+	std::vector<adsProbeResult_t> results;
+	adsProbe(i2cDeviceNames, busCount, results);
+
+	for (size_t i = 0; i < results.size(); i++)
+		devices.push_back(adsCreate(results[i]));
+
+	return results.size();
+}
@@ -0,0 +1,55 @@
+/**************************************************************************/
+/*!
+    @file     ADS1X15_Probe.h
+
+    Bus discovery and chip-type auto-detection for the ADS1015, ADS1115
+    and TLA2024.
+
+    Every valid address (0x48..0x4B) of each bus is probed. Buses are
+    scanned in parallel, one thread per bus, and each bus is opened only
+    once. Other parts share these addresses (LM75, TMP102, PCF8591...), so
+    a device is only written to once its config and threshold registers
+    read like an ADS1x15/TLA2024, and its config
+    is written back when the probe is done. The chips are told apart by:
+
+    - the config register reserved bits (bits 4:0 always read 03h on the
+      TLA2024, they hold the comparator settings on the ADS1x15)
+    - the conversion resolution (the 4 LSBs are always 0 on 12-bit parts)
+    - the conversion time at the fastest data rate (3300 SPS on 12-bit
+      parts, 860 SPS on the ADS1115)
+
+    @section license License
+
+    BSD license, all text here must be included in any redistribution
+*/
+/**************************************************************************/
+
+#ifndef ADS1X15_PROBE_H
+#define ADS1X15_PROBE_H
+
+#include <vector>
+
+#include "ADS1X15_TLA2024.h"
+
+/*=========================================================================
+    PROBE SETTINGS
+    -----------------------------------------------------------------------*/
+#define ADS_PROBE_SAMPLES          (4)   ///< Conversions used for the resolution test
+#define ADS_PROBE_TIMEOUT          (5000) ///< Max conversion wait in uS
+#define ADS_PROBE_12BIT_MAXDELAY   (900) ///< Slower conversions at DR=111 are ADS1115
+/*=========================================================================*/
+
+/** A device found on the bus */
+typedef struct {
+    const char* i2cDeviceName; ///< bus the device was found on (not copied)
+    uint8_t     i2cAddress;    ///< I2C address of the device
+    uint8_t     adsType;       ///< tla2024, ads1015 or ads1115
+} adsProbeResult_t;
+
+size_t adsProbe(const char* const* i2cDeviceNames, size_t busCount,
+                std::vector<adsProbeResult_t>& results);
+TLA2024* adsCreate(const adsProbeResult_t& result);
+size_t adsProbeDevices(const char* const* i2cDeviceNames, size_t busCount,
+                       std::vector<TLA2024*>& devices);
+
+#endif // ADS1X15_PROBE_H
@@ -0,0 +1,275 @@
+/**************************************************************************/
+/*!
+	@file     ADS1X15_RateScheduler.cpp
+
+	Mixed-rate channel scheduler for the multiplexer of one chip.
+
+	@section license License
+
+	BSD license, all text here must be included in any redistribution
+*/
+/**************************************************************************/
+
+#include "ADS1X15_RateScheduler.h"
+
+/// Data rate settings from the slowest to the fastest, for every chip
+static const adsSps_t rateSettings[] = { SPS_128, SPS_250, SPS_490, SPS_920, SPS_1600, SPS_2400, SPS_3300, SPS_860 };
+
+/**************************************************************************/
+/*!
+	@brief  Instantiates a scheduler for one chip
+
+	@param device device to convert on, must outlive the scheduler
+*/
+/**************************************************************************/
+adsRateScheduler::adsRateScheduler(TLA2024& device)
+{
+	m_device = &device;
+	m_busOverheadUs = ADS_RATE_BUS_OVERHEAD;
+}
+
+/**************************************************************************/
+/*!
+	@brief  Adds an input with its target rate
+
+	@param input ADS_INPUT_* multiplexer setting
+	@param rateHz conversions per second
+	@param deadlineUs time allowed from release to completion, 0 for the period
+
+	@return the input index in the scheduler, -1 on error
+*/
+/**************************************************************************/
+int adsRateScheduler::addInput(uint8_t input, double rateHz, uint32_t deadlineUs) {
+	if (input >= ADS_INPUT_COUNT || rateHz <= 0 || m_tasks.size() > 0xFF)
+		return -1;
+
+	task_t task;
+	memset(&task, 0, sizeof(task));
+	task.input = input;
+	task.rateHz = rateHz;
+	task.periodNs = (uint64_t)(1000000000.0 / rateHz);
+	task.deadlineNs = deadlineUs ? (uint64_t)deadlineUs * 1000 : task.periodNs;
+	m_tasks.push_back(task);
+
+	return m_tasks.size() - 1;
+}
+
+/**************************************************************************/
+/*!
+	@brief  Sets the I2C time of one single-shot conversion (config write,
+			OS poll, conversion read), it depends on the bus clock
+
+	@param overheadUs I2C time per conversion in uS
+*/
+/**************************************************************************/
+void adsRateScheduler::setBusOverhead(uint32_t overheadUs) {
+	m_busOverheadUs = overheadUs;
+}
+
+/**************************************************************************/
+/*!
+	@brief  Gets the converter share used by the inputs for a slot length
+*/
+/**************************************************************************/
+double adsRateScheduler::utilizationAt(uint32_t slotUs) const {
+	double utilization = 0;
+	for (size_t i = 0; i < m_tasks.size(); i++)
+		utilization += m_tasks[i].rateHz * slotUs / 1000000.0;
+
+	return utilization;
+}
+
+/**************************************************************************/
+/*!
+	@brief  Checks the deadlines for a slot length.  Sufficient test for
+			non-preemptive EDF: for every deadline D, the density
+			(slot / min(deadline, period)) of the inputs due within D,
+			plus one blocking slot over D, stays at or below 1.
+*/
+/**************************************************************************/
+bool adsRateScheduler::deadlinesMetAt(uint32_t slotUs) const {
+	double slotNs = slotUs * 1000.0;
+	for (size_t k = 0; k < m_tasks.size(); k++)
+	{
+		uint64_t deadline = m_tasks[k].deadlineNs;
+		double density = slotNs / deadline;
+		for (size_t j = 0; j < m_tasks.size(); j++)
+		{
+			if (m_tasks[j].deadlineNs > deadline)
+				continue;
+			uint64_t window = m_tasks[j].deadlineNs < m_tasks[j].periodNs ? m_tasks[j].deadlineNs : m_tasks[j].periodNs;
+			density += slotNs / window;
+		}
+
+		if (density > 1)
+			return false;
+	}
+
+	return true;
+}
+
+/**************************************************************************/
+/*!
+	@brief  Picks the slowest data rate meeting every rate and deadline
+			and applies it to the device
+
+	@return 1 if the set is schedulable, -1 otherwise (the data rate is
+			then left unchanged)
+*/
+/**************************************************************************/
+int adsRateScheduler::plan() {
+	adsSps_t previous = m_device->getSps();
+
+	for (size_t r = 0; r < sizeof(rateSettings) / sizeof(rateSettings[0]); r++)
+	{
+		m_device->setSps(rateSettings[r]);
+		uint32_t slot = slotUs();
+		if (utilizationAt(slot) <= ADS_RATE_MAX_UTILIZATION && deadlinesMetAt(slot))
+			return 1;
+	}
+
+	// Still set to the fastest data rate here
+	fprintf(stderr, "The requested rates cannot be met, the converter would be %d%% busy at the fastest data rate!\n",
+		(int)(utilization() * 100));
+	m_device->setSps(previous);
+	return -1;
+}
+
+/**************************************************************************/
+/*!
+	@brief  Gets the converter share used at the current data rate
+*/
+/**************************************************************************/
+double adsRateScheduler::utilization() const {
+	return utilizationAt(slotUs());
+}
+
+/**************************************************************************/
+/*!
+	@brief  Gets the length of a conversion slot at the current data rate
+
+	@return the slot length in uS
+*/
+/**************************************************************************/
+uint32_t adsRateScheduler::slotUs() const {
+	return m_device->getConversionDelay() + m_busOverheadUs;
+}
+
+/**************************************************************************/
+/*!
+	@brief  Releases the first job of every input now and clears the stats
+*/
+/**************************************************************************/
+void adsRateScheduler::start() {
+	uint64_t now = adsTimestampNs();
+	for (size_t i = 0; i < m_tasks.size(); i++)
+	{
+		m_tasks[i].releaseNs = now;
+		memset(&m_tasks[i].stats, 0, sizeof(m_tasks[i].stats));
+	}
+}
+
+/**************************************************************************/
+/*!
+	@brief  Runs the next conversion in earliest deadline first order,
+			sleeping until a job is released if none is pending
+
+	@param sample result of the conversion, channel is the input index
+			in the scheduler
+
+	@return 1 on success, -1 if there is no input
+*/
+/**************************************************************************/
+int adsRateScheduler::step(adsSample_t* sample) {
+	if (m_tasks.empty())
+		return -1;
+
+	uint64_t now = adsTimestampNs();
+	int best = -1;
+	while (best < 0)
+	{
+		uint64_t nextRelease = UINT64_MAX;
+		for (size_t i = 0; i < m_tasks.size(); i++)
+		{
+			task_t* task = &m_tasks[i];
+			if (task->releaseNs > now) {
+				if (task->releaseNs < nextRelease)
+					nextRelease = task->releaseNs;
+				continue;
+			}
+
+			if (best < 0 || task->releaseNs + task->deadlineNs < m_tasks[best].releaseNs + m_tasks[best].deadlineNs)
+				best = i;
+		}
+
+		if (best < 0) {
+			struct timespec ts;
+			ts.tv_sec = nextRelease / 1000000000ULL;
+			ts.tv_nsec = nextRelease % 1000000000ULL;
+			clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, NULL);
+			now = adsTimestampNs();
+		}
+	}
+
+	task_t* task = &m_tasks[best];
+	if (now - task->releaseNs > task->stats.maxJitterNs)
+		task->stats.maxJitterNs = now - task->releaseNs;
+
+	sample->value = m_device->readADC_Input(task->input);
+	sample->timestampNs = adsTimestampNs();
+	sample->channel = best;
+	sample->input = task->input;
+	sample->alert = 0;
+
+	task->stats.conversions++;
+	uint64_t deadline = task->releaseNs + task->deadlineNs;
+	if (sample->timestampNs > deadline) {
+		task->stats.missed++;
+		if (sample->timestampNs - deadline > task->stats.maxLatenessNs)
+			task->stats.maxLatenessNs = sample->timestampNs - deadline;
+	}
+
+	// Overloaded: drop the releases already in the past instead of bursting
+	task->releaseNs += task->periodNs;
+	if (task->releaseNs + task->periodNs <= sample->timestampNs) {
+		uint64_t behind = (sample->timestampNs - task->releaseNs) / task->periodNs;
+		task->stats.skipped += behind;
+		task->releaseNs += behind * task->periodNs;
+	}
+
+	for (size_t i = 0; i < m_sinks.size(); i++)
+		m_sinks[i]->onSample(*sample);
+
+	return 1;
+}
+
+/**************************************************************************/
+/*!
+	@brief  Adds a stage fed with every sample of the scheduler
+
+	@param sink stage to feed, must outlive the scheduler
+*/
+/**************************************************************************/
+void adsRateScheduler::addSink(adsSampleSink* sink) {
+	m_sinks.push_back(sink);
+}
+
+/**************************************************************************/
+/*!
+	@brief  Gets the number of scheduled inputs
+*/
+/**************************************************************************/
+size_t adsRateScheduler::inputCount() const {
+	return m_tasks.size();
+}
+
+/**************************************************************************/
+/*!
+	@brief  Gets the statistics of a scheduled input
+
+	@param task input index returned by addInput()
+*/
+/**************************************************************************/
+const adsRateStats_t& adsRateScheduler::stats(uint8_t task) const {
+	return m_tasks[task < m_tasks.size() ? task : 0].stats;
+}
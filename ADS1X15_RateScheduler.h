@@ -0,0 +1,88 @@
+/**************************************************************************/
+/*!
+    @file     ADS1X15_RateScheduler.h
+
+    Mixed-rate channel scheduler for the multiplexer of one chip.
+
+    Each input (single-ended channel or differential pair) gets its own
+    target rate and relative deadline. plan() picks the slowest data rate
+    (least noise) for which the set is schedulable and reports when no
+    data rate can meet it. step() then runs the conversions in earliest
+    deadline first order, so fast channels keep a low jitter while slow
+    channels fill the remaining slots.
+
+    One conversion slot is the conversion delay plus the I2C transfer time
+    of a single-shot conversion (see setBusOverhead()). Conversions are
+    not preemptive, so a job may be blocked by one slot of another job;
+    plan() accounts for it with a density test per deadline (see
+    deadlinesMetAt()), which also holds for deadlines shorter than the
+    period.
+
+    @section license License
+
+    BSD license, all text here must be included in any redistribution
+*/
+/**************************************************************************/
+
+#ifndef ADS1X15_RATESCHEDULER_H
+#define ADS1X15_RATESCHEDULER_H
+
+#include <vector>
+
+#include "ADS1X15_TLA2024.h"
+
+/*=========================================================================
+    RATE SCHEDULER SETTINGS
+    -----------------------------------------------------------------------*/
+#define ADS_RATE_MAX_UTILIZATION (0.95) ///< Converter share plan() may use
+#define ADS_RATE_BUS_OVERHEAD    (300)  ///< Default I2C time per conversion in uS (400 kHz)
+/*=========================================================================*/
+
+/** Statistics of one scheduled input */
+typedef struct {
+    uint64_t conversions;    ///< conversions done
+    uint64_t missed;         ///< conversions completed after their deadline
+    uint64_t skipped;        ///< releases dropped while overloaded
+    uint64_t maxJitterNs;    ///< worst delay between release and start
+    uint64_t maxLatenessNs;  ///< worst completion after the deadline
+} adsRateStats_t;
+
+/**************************************************************************/
+/*!
+    @brief  EDF scheduler of per-input target rates over one multiplexer
+*/
+/**************************************************************************/
+class adsRateScheduler {
+public:
+    adsRateScheduler(TLA2024& device);
+    int      addInput(uint8_t input, double rateHz, uint32_t deadlineUs = 0);
+    void     setBusOverhead(uint32_t overheadUs);
+    int      plan(void);
+    double   utilization(void) const;
+    uint32_t slotUs(void) const;
+    void     start(void);
+    int      step(adsSample_t* sample);
+    void     addSink(adsSampleSink* sink);
+    size_t   inputCount(void) const;
+    const adsRateStats_t& stats(uint8_t task) const;
+
+private:
+    typedef struct {
+        uint8_t        input;
+        double         rateHz;
+        uint64_t       periodNs;
+        uint64_t       deadlineNs;   ///< relative deadline
+        uint64_t       releaseNs;    ///< release of the pending job
+        adsRateStats_t stats;
+    } task_t;
+
+    double   utilizationAt(uint32_t slotUs) const;
+    bool     deadlinesMetAt(uint32_t slotUs) const;
+
+    TLA2024*                    m_device;
+    std::vector<task_t>         m_tasks;
+    std::vector<adsSampleSink*> m_sinks;
+    uint32_t                    m_busOverheadUs;
+};
+
+#endif // ADS1X15_RATESCHEDULER_H
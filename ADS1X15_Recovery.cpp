@@ -0,0 +1,212 @@
+/**************************************************************************/
+/*!
+	@file     ADS1X15_Recovery.cpp
+
+	Background reconnection of devices that stopped answering.
+
+	@section license License
+
+	BSD license, all text here must be included in any redistribution
+*/
+/**************************************************************************/
+
+#include <chrono>
+#include <system_error>
+
+#include "ADS1X15_Recovery.h"
+
+/**************************************************************************/
+/*!
+	@brief  Instantiates a stopped monitor
+*/
+/**************************************************************************/
+adsRecovery::adsRecovery()
+{
+	m_running = false;
+}
+
+/**************************************************************************/
+/*!
+	@brief  Stops the monitor, the devices keep their recovery setting
+*/
+/**************************************************************************/
+adsRecovery::~adsRecovery()
+{
+	stop();
+}
+
+/**************************************************************************/
+/*!
+	@brief  Watches a device and enables its failure tracking
+
+	@param device device to watch, must outlive the monitor
+
+	@return 1 on success, -1 on error
+*/
+/**************************************************************************/
+int adsRecovery::addDevice(TLA2024* device) {
+	if (!device)
+		return -1;
+
+	std::lock_guard<std::mutex> guard(m_mutex);
+	for (size_t i = 0; i < m_entries.size(); i++)
+		if (m_entries[i].device == device)
+			return 1;
+
+	entry_t entry;
+	memset(&entry, 0, sizeof(entry));
+	entry.device = device;
+	entry.backoffMs = ADS_RECOVERY_BACKOFF_MIN;
+	m_entries.push_back(entry);
+	device->setRecovery(true);
+
+	return 1;
+}
+
+/**************************************************************************/
+/*!
+	@brief  Starts the monitor thread
+
+	@return 1 on success, -1 on error
+*/
+/**************************************************************************/
+int adsRecovery::start() {
+	std::lock_guard<std::mutex> guard(m_mutex);
+	if (m_running)
+		return 1;
+
+	m_running = true;
+	try {
+		m_worker = std::thread(&adsRecovery::run, this);
+	}
+	catch (const std::system_error& error) {
+		fprintf(stderr, "Error while starting the recovery monitor! Error: %s\n", error.what());
+		m_running = false;
+		return -1;
+	}
+
+	return 1;
+}
+
+/**************************************************************************/
+/*!
+	@brief  Stops the monitor thread.  Unavailable devices stay unavailable
+			until the monitor is started again.
+*/
+/**************************************************************************/
+void adsRecovery::stop() {
+	{
+		std::lock_guard<std::mutex> guard(m_mutex);
+		if (!m_running)
+			return;
+		m_running = false;
+	}
+	m_wakeup.notify_one();
+	m_worker.join();
+}
+
+/**************************************************************************/
+/*!
+	@brief  Gets the outage statistics of a watched device
+*/
+/**************************************************************************/
+adsRecoveryStats_t adsRecovery::stats(TLA2024* device) {
+	std::lock_guard<std::mutex> guard(m_mutex);
+	adsRecoveryStats_t stats;
+	memset(&stats, 0, sizeof(stats));
+	for (size_t i = 0; i < m_entries.size(); i++)
+		if (m_entries[i].device == device)
+			stats = m_entries[i].stats;
+
+	stats.available = device && device->isAvailable();
+	return stats;
+}
+
+/**************************************************************************/
+/*!
+	@brief  Checks if a chip acknowledges a read of its config register,
+			single attempt on a private file descriptor
+
+	@return true if the chip answered
+*/
+/**************************************************************************/
+bool adsRecovery::probe(const char* i2cDeviceName, uint8_t i2cAddress) {
+	int fd = open(i2cDeviceName, O_RDWR);
+	if (fd < 0)
+		return false;
+
+	unsigned char pointer = ADS1015_REG_POINTER_CONFIG;
+	unsigned char config[2];
+	bool answered = ioctl(fd, I2C_SLAVE, i2cAddress) >= 0
+		&& write(fd, &pointer, 1) == 1
+		&& read(fd, config, 2) == 2;
+	close(fd);
+
+	return answered;
+}
+
+/**************************************************************************/
+/*!
+	@brief  Monitor thread: probes the unavailable devices with an
+			exponential backoff
+*/
+/**************************************************************************/
+void adsRecovery::run() {
+	std::unique_lock<std::mutex> lock(m_mutex);
+	while (m_running)
+	{
+		uint64_t now = adsTimestampNs();
+		uint64_t wake = now + (uint64_t)ADS_RECOVERY_CHECK_INTERVAL * 1000000;
+		for (size_t i = 0; i < m_entries.size(); i++)
+		{
+			entry_t* entry = &m_entries[i];
+			if (entry->device->isAvailable()) {
+				entry->outageStartNs = 0;
+				continue;
+			}
+
+			if (!entry->outageStartNs) {
+				entry->outageStartNs = now;
+				entry->backoffMs = ADS_RECOVERY_BACKOFF_MIN;
+				entry->nextProbeNs = now + (uint64_t)entry->backoffMs * 1000000;
+				entry->stats.outages++;
+			}
+
+			if (entry->nextProbeNs > now) {
+				if (entry->nextProbeNs < wake)
+					wake = entry->nextProbeNs;
+				continue;
+			}
+
+			// The entries only grow, the device stays valid without the lock
+			TLA2024* device = entry->device;
+			lock.unlock();
+			bool answered = probe(device->getI2cDeviceName(), device->getI2cAddress());
+			lock.lock();
+			entry = &m_entries[i];
+			entry->stats.probes++;
+
+			now = adsTimestampNs();
+			if (answered) {
+				uint64_t outage = now - entry->outageStartNs;
+				entry->stats.lastOutageNs = outage;
+				if (outage > entry->stats.maxOutageNs)
+					entry->stats.maxOutageNs = outage;
+				entry->outageStartNs = 0;
+				device->markReconnected();
+				continue;
+			}
+
+			entry->backoffMs *= 2;
+			if (entry->backoffMs > ADS_RECOVERY_BACKOFF_MAX)
+				entry->backoffMs = ADS_RECOVERY_BACKOFF_MAX;
+			entry->nextProbeNs = now + (uint64_t)entry->backoffMs * 1000000;
+			if (entry->nextProbeNs < wake)
+				wake = entry->nextProbeNs;
+		}
+
+		now = adsTimestampNs();
+		if (wake > now)
+			m_wakeup.wait_for(lock, std::chrono::nanoseconds(wake - now));
+	}
+}
@@ -0,0 +1,88 @@
+/**************************************************************************/
+/*!
+    @file     ADS1X15_Recovery.h
+
+    Background reconnection of devices that stopped answering.
+
+    A device added to the monitor tracks its failed transactions (see
+    TLA2024::setRecovery()). After ADS_RECOVERY_FAIL_COUNT failures in a
+    row it is unavailable: its calls return at once instead of going
+    through the open retries, and the monitor thread probes its address
+    on its own file descriptor with an exponential backoff. Once the chip
+    answers again the device is available, and its cached configuration
+    (comparator threshold, continuous mode) is written back by the next
+    transaction; gain and data rate are part of every conversion.
+
+    The device objects are kept, nothing has to be constructed again.
+    Moving a chip to another bus is updateI2cDevice(), which restores the
+    configuration the same way.
+
+    @section license License
+
+    BSD license, all text here must be included in any redistribution
+*/
+/**************************************************************************/
+
+#ifndef ADS1X15_RECOVERY_H
+#define ADS1X15_RECOVERY_H
+
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "ADS1X15_TLA2024.h"
+
+/*=========================================================================
+    RECOVERY SETTINGS
+    -----------------------------------------------------------------------*/
+#define ADS_RECOVERY_CHECK_INTERVAL (5)    ///< Availability check interval in mS
+#define ADS_RECOVERY_BACKOFF_MIN    (10)   ///< First probe delay after a failure in mS
+#define ADS_RECOVERY_BACKOFF_MAX    (2000) ///< Longest delay between two probes in mS
+/*=========================================================================*/
+
+/** Outage statistics of one device */
+typedef struct {
+    uint64_t outages;       ///< times the device became unavailable
+    uint64_t probes;        ///< reconnection attempts
+    uint64_t lastOutageNs;  ///< length of the last finished outage
+    uint64_t maxOutageNs;   ///< longest finished outage
+    bool     available;     ///< current state
+} adsRecoveryStats_t;
+
+/**************************************************************************/
+/*!
+    @brief  Monitor thread reconnecting the unavailable devices
+*/
+/**************************************************************************/
+class adsRecovery {
+public:
+    adsRecovery();
+    ~adsRecovery();
+    int  addDevice(TLA2024* device);
+    int  start(void);
+    void stop(void);
+    adsRecoveryStats_t stats(TLA2024* device);
+
+private:
+    typedef struct {
+        TLA2024*           device;
+        uint64_t           outageStartNs; ///< 0 while available
+        uint64_t           nextProbeNs;
+        uint32_t           backoffMs;
+        adsRecoveryStats_t stats;
+    } entry_t;
+
+    adsRecovery(const adsRecovery&);
+    adsRecovery& operator=(const adsRecovery&);
+    void run(void);
+    static bool probe(const char* i2cDeviceName, uint8_t i2cAddress);
+
+    std::mutex              m_mutex;
+    std::condition_variable m_wakeup;
+    std::thread             m_worker;
+    bool                    m_running;
+    std::vector<entry_t>    m_entries;
+};
+
+#endif // ADS1X15_RECOVERY_H
@@ -0,0 +1,358 @@
+/**************************************************************************/
+/*!
+	@file     ADS1X15_SampleBlock.cpp
+
+	Columnar (struct-of-arrays) block of samples.
+
+	@section license License
+
+	BSD license, all text here must be included in any redistribution
+*/
+/**************************************************************************/
+
+#include "ADS1X15_SampleBlock.h"
+#include "ADS1X15_Iio.h"
+
+/// Rounds a column size up to a whole number of cache lines
+#define ADS_BLOCK_ROUNDUP(bytes)                                                 \
+	(((bytes) + ADS_BLOCK_ALIGNMENT - 1) & ~(size_t)(ADS_BLOCK_ALIGNMENT - 1))
+
+/**************************************************************************/
+/*!
+	@brief  Instantiates an empty block, nothing is allocated until create()
+*/
+/**************************************************************************/
+adsSampleBlock::adsSampleBlock()
+{
+	m_memory = NULL;
+	m_timestamps = NULL;
+	m_capacity = 0;
+	m_stamped = 0;
+	m_adsType = tla2024;
+	m_gain = GAIN_TWOTHIRDS;
+	m_sps = SPS_1600;
+}
+
+/**************************************************************************/
+/*!
+	@brief  Frees the columns
+*/
+/**************************************************************************/
+adsSampleBlock::~adsSampleBlock()
+{
+	release();
+}
+
+/**************************************************************************/
+/*!
+	@brief  Frees the columns
+*/
+/**************************************************************************/
+void adsSampleBlock::release() {
+	free(m_memory);
+	m_memory = NULL;
+	m_timestamps = NULL;
+	m_columns.clear();
+	m_fill.clear();
+	m_inputs.clear();
+	m_capacity = 0;
+	m_stamped = 0;
+}
+
+/**************************************************************************/
+/*!
+	@brief  Allocates the columns
+
+	@param inputs ADS_INPUT_* setting of each channel
+	@param channelCount number of channels
+	@param capacity rows the block can hold
+
+	@return 1 on success, -1 on error
+*/
+/**************************************************************************/
+int adsSampleBlock::create(const uint8_t* inputs, size_t channelCount, size_t capacity) {
+	release();
+	if (channelCount == 0 || channelCount > 0xFF || capacity == 0)
+		return -1;
+
+	size_t timestampBytes = ADS_BLOCK_ROUNDUP(capacity * sizeof(uint64_t));
+	size_t columnBytes = ADS_BLOCK_ROUNDUP(capacity * sizeof(int16_t));
+	m_memory = aligned_alloc(ADS_BLOCK_ALIGNMENT, timestampBytes + channelCount * columnBytes);
+	if (!m_memory) {
+		fprintf(stderr, "Error while allocating a sample block of %d rows!\n", (int)capacity);
+		return -1;
+	}
+
+	uint8_t* memory = (uint8_t*)m_memory;
+	m_timestamps = (uint64_t*)memory;
+	for (size_t i = 0; i < channelCount; i++)
+		m_columns.push_back((int16_t*)(memory + timestampBytes + i * columnBytes));
+	m_fill.assign(channelCount, 0);
+	m_inputs.assign(inputs, inputs + channelCount);
+	m_capacity = capacity;
+
+	return 1;
+}
+
+/**************************************************************************/
+/*!
+	@brief  Sets the settings shared by every sample of the block
+
+	@param adsType tla2024, ads1015 or ads1115
+	@param gain gain setting
+	@param sps sample rate setting
+*/
+/**************************************************************************/
+void adsSampleBlock::setMetadata(uint8_t adsType, adsGain_t gain, adsSps_t sps) {
+	m_adsType = adsType;
+	m_gain = gain;
+	m_sps = sps;
+}
+
+/**************************************************************************/
+/*!
+	@brief  Empties the block, the columns are kept
+*/
+/**************************************************************************/
+void adsSampleBlock::clear() {
+	m_fill.assign(m_fill.size(), 0);
+	m_stamped = 0;
+}
+
+/**************************************************************************/
+/*!
+	@brief  Appends one sample to a channel column.  The first sample
+			written to a row gives the row its timestamp.
+
+	@param channel channel index
+	@param value ADC code
+	@param timestampNs time of the conversion
+
+	@return 1 on success, -1 if the column is full
+*/
+/**************************************************************************/
+int adsSampleBlock::appendSample(uint8_t channel, int16_t value, uint64_t timestampNs) {
+	if (channel >= m_columns.size() || m_fill[channel] >= m_capacity)
+		return -1;
+
+	size_t row = m_fill[channel]++;
+	m_columns[channel][row] = value;
+	if (row >= m_stamped)
+		m_timestamps[m_stamped++] = timestampNs;
+
+	return 1;
+}
+
+/**************************************************************************/
+/*!
+	@brief  Appends one sample to every channel
+
+	@param values one ADC code per channel
+	@param timestampNs time of the row
+
+	@return 1 on success, -1 if the block is full
+*/
+/**************************************************************************/
+int adsSampleBlock::appendRow(const int16_t* values, uint64_t timestampNs) {
+	if (headroom() == 0)
+		return -1;
+
+	for (size_t i = 0; i < m_columns.size(); i++)
+		appendSample(i, values[i], timestampNs);
+
+	return 1;
+}
+
+/**************************************************************************/
+/*!
+	@brief  Marks rows written straight through column() and timestamps()
+			as complete, e.g. by a decoder.  Every channel and the
+			timestamp column must hold at least rows entries.
+
+	@param rows number of complete rows
+
+	@return 1 on success, -1 if rows exceeds the capacity
+*/
+/**************************************************************************/
+int adsSampleBlock::commitRows(size_t rows) {
+	if (rows > m_capacity)
+		return -1;
+
+	for (size_t i = 0; i < m_fill.size(); i++)
+		m_fill[i] = rows;
+	m_stamped = rows;
+
+	return 1;
+}
+
+/**************************************************************************/
+/*!
+	@brief  Gets the number of complete rows
+*/
+/**************************************************************************/
+size_t adsSampleBlock::size() const {
+	if (m_fill.empty())
+		return 0;
+
+	size_t rows = m_fill[0];
+	for (size_t i = 1; i < m_fill.size(); i++)
+		if (m_fill[i] < rows)
+			rows = m_fill[i];
+
+	return rows;
+}
+
+/**************************************************************************/
+/*!
+	@brief  Gets the number of rows the block can hold
+*/
+/**************************************************************************/
+size_t adsSampleBlock::capacity() const {
+	return m_capacity;
+}
+
+/**************************************************************************/
+/*!
+	@brief  Gets the number of channels
+*/
+/**************************************************************************/
+size_t adsSampleBlock::channelCount() const {
+	return m_columns.size();
+}
+
+/**************************************************************************/
+/*!
+	@brief  Gets the number of samples any channel can still append
+*/
+/**************************************************************************/
+size_t adsSampleBlock::headroom() const {
+	size_t fill = 0;
+	for (size_t i = 0; i < m_fill.size(); i++)
+		if (m_fill[i] > fill)
+			fill = m_fill[i];
+
+	return m_capacity - fill;
+}
+
+/**************************************************************************/
+/*!
+	@brief  Checks if every row is complete
+*/
+/**************************************************************************/
+bool adsSampleBlock::full() const {
+	return m_capacity != 0 && size() == m_capacity;
+}
+
+/**************************************************************************/
+/*!
+	@brief  Gets the ADS_INPUT_* setting of a channel
+*/
+/**************************************************************************/
+uint8_t adsSampleBlock::input(uint8_t channel) const {
+	return channel < m_inputs.size() ? m_inputs[channel] : 0;
+}
+
+/**************************************************************************/
+/*!
+	@brief  Gets the column of a channel, ADS_BLOCK_ALIGNMENT aligned
+*/
+/**************************************************************************/
+const int16_t* adsSampleBlock::column(uint8_t channel) const {
+	return channel < m_columns.size() ? m_columns[channel] : NULL;
+}
+
+/**************************************************************************/
+/*!
+	@brief  Gets the column of a channel, ADS_BLOCK_ALIGNMENT aligned
+*/
+/**************************************************************************/
+int16_t* adsSampleBlock::column(uint8_t channel) {
+	return channel < m_columns.size() ? m_columns[channel] : NULL;
+}
+
+/**************************************************************************/
+/*!
+	@brief  Gets the timestamp column, one entry per row
+*/
+/**************************************************************************/
+const uint64_t* adsSampleBlock::timestamps() const {
+	return m_timestamps;
+}
+
+/**************************************************************************/
+/*!
+	@brief  Gets the timestamp column for writing, see commitRows()
+*/
+/**************************************************************************/
+uint64_t* adsSampleBlock::timestamps() {
+	return m_timestamps;
+}
+
+/**************************************************************************/
+/*!
+	@brief  Gets the chip type of the block
+*/
+/**************************************************************************/
+uint8_t adsSampleBlock::adsType() const {
+	return m_adsType;
+}
+
+/**************************************************************************/
+/*!
+	@brief  Gets the gain setting of the block
+*/
+/**************************************************************************/
+adsGain_t adsSampleBlock::gain() const {
+	return m_gain;
+}
+
+/**************************************************************************/
+/*!
+	@brief  Gets the sample rate setting of the block
+*/
+/**************************************************************************/
+adsSps_t adsSampleBlock::sps() const {
+	return m_sps;
+}
+
+/**************************************************************************/
+/*!
+	@brief  Bulk read: scans the block inputs on one device, writing the
+			results straight into the columns
+
+	@param device device to convert on
+	@param block block to fill, its metadata is set from the device
+	@param rows number of scans to run
+
+	@return the number of rows appended, fewer than rows if a conversion
+			failed
+*/
+/**************************************************************************/
+size_t adsReadBlock(TLA2024& device, adsSampleBlock& block, size_t rows) {
+	block.setMetadata(device.getAdsType(), device.getGain(), device.getSps());
+
+	// Kernel buffer: one read() per block
+	adsIio* iio = device.getIio();
+	if (iio && block.channelCount() == 1) {
+		if (iio->configure(block.input(0), device.getAdsType(), device.getGain(), device.getSps()) < 0)
+			return 0;
+		return iio->readBlock(block, rows);
+	}
+
+	// A row is only appended once every channel converted, a failed
+	// conversion ends the scan instead of storing a made-up code
+	std::vector<int16_t> row(block.channelCount());
+	size_t appended = 0;
+	while (appended < rows && block.headroom() > 0)
+	{
+		uint64_t timestampNs = adsTimestampNs();
+		for (size_t i = 0; i < row.size(); i++)
+			if (device.readADC_Input(block.input(i), &row[i]) < 0)
+				return appended;
+
+		block.appendRow(row.data(), timestampNs);
+		appended++;
+	}
+
+	return appended;
+}
@@ -0,0 +1,83 @@
+/**************************************************************************/
+/*!
+    @file     ADS1X15_SampleBlock.h
+
+    Columnar (struct-of-arrays) block of samples.
+
+    Each channel's codes are stored contiguously in their own cache-line
+    aligned column, next to a single timestamp column shared by all
+    channels. The chip, gain and data rate are kept once per block.
+    A row holds one sample of every channel (one scan); the columns can
+    be filled independently, a row is complete once every channel has
+    written it.
+
+    @section license License
+
+    BSD license, all text here must be included in any redistribution
+*/
+/**************************************************************************/
+
+#ifndef ADS1X15_SAMPLEBLOCK_H
+#define ADS1X15_SAMPLEBLOCK_H
+
+#include <vector>
+
+#include "ADS1X15_TLA2024.h"
+
+/*=========================================================================
+    SAMPLE BLOCK SETTINGS
+    -----------------------------------------------------------------------*/
+#define ADS_BLOCK_ALIGNMENT (64) ///< Column alignment in bytes (cache line)
+/*=========================================================================*/
+
+/**************************************************************************/
+/*!
+    @brief  Per-channel contiguous sample columns with a shared timestamp
+            column
+*/
+/**************************************************************************/
+class adsSampleBlock {
+public:
+    adsSampleBlock();
+    ~adsSampleBlock();
+    int  create(const uint8_t* inputs, size_t channelCount, size_t capacity);
+    void setMetadata(uint8_t adsType, adsGain_t gain, adsSps_t sps);
+    void clear(void);
+    int  appendRow(const int16_t* values, uint64_t timestampNs);
+    int  appendSample(uint8_t channel, int16_t value, uint64_t timestampNs);
+    int  commitRows(size_t rows);
+
+    size_t          size(void) const;
+    size_t          capacity(void) const;
+    size_t          channelCount(void) const;
+    size_t          headroom(void) const;
+    bool            full(void) const;
+    uint8_t         input(uint8_t channel) const;
+    const int16_t*  column(uint8_t channel) const;
+    int16_t*        column(uint8_t channel);
+    const uint64_t* timestamps(void) const;
+    uint64_t*       timestamps(void);
+    uint8_t         adsType(void) const;
+    adsGain_t       gain(void) const;
+    adsSps_t        sps(void) const;
+
+private:
+    adsSampleBlock(const adsSampleBlock&);
+    adsSampleBlock& operator=(const adsSampleBlock&);
+    void release(void);
+
+    void*                m_memory;     ///< single aligned allocation for all columns
+    uint64_t*            m_timestamps; ///< time of the first sample of each row
+    std::vector<int16_t*> m_columns;
+    std::vector<size_t>  m_fill;       ///< samples written per channel
+    std::vector<uint8_t> m_inputs;     ///< ADS_INPUT_* setting of each channel
+    size_t               m_capacity;
+    size_t               m_stamped;    ///< rows with a timestamp
+    uint8_t              m_adsType;
+    adsGain_t            m_gain;
+    adsSps_t             m_sps;
+};
+
+size_t adsReadBlock(TLA2024& device, adsSampleBlock& block, size_t rows);
+
+#endif // ADS1X15_SAMPLEBLOCK_H
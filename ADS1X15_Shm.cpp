@@ -0,0 +1,204 @@
+/**************************************************************************/
+/*!
+	@file     ADS1X15_Shm.cpp
+
+	Daemon side of the sampling shared memory.
+
+	@section license License
+
+	BSD license, all text here must be included in any redistribution
+*/
+/**************************************************************************/
+
+#include "ADS1X15_Shm.h"
+
+/**************************************************************************/
+/*!
+	@brief  Instantiates a writer, nothing is mapped until create()
+*/
+/**************************************************************************/
+adsShmWriter::adsShmWriter()
+{
+	m_header = NULL;
+	m_size = 0;
+	m_name[0] = '\0';
+	m_sequence = 0;
+}
+
+/**************************************************************************/
+/*!
+	@brief  Removes the shared memory object
+*/
+/**************************************************************************/
+adsShmWriter::~adsShmWriter()
+{
+	destroy();
+}
+
+/**************************************************************************/
+/*!
+	@brief  Creates and maps the shared memory object.  Readers cannot
+			attach until publishChannels() is called.
+
+	@param name shared memory object name
+	@param ringSize history ring entries, must be a power of 2
+
+	@return 1 on success, -1 on error
+*/
+/**************************************************************************/
+int adsShmWriter::create(const char* name, uint32_t ringSize) {
+	if (ringSize == 0 || (ringSize & (ringSize - 1)) != 0) {
+		fprintf(stderr, "The history ring size must be a power of 2!\n");
+		return -1;
+	}
+
+	destroy();
+
+	// A stale object from a previous daemon is replaced
+	shm_unlink(name);
+	int fd = shm_open(name, O_RDWR | O_CREAT | O_EXCL, 0644);
+	if (fd < 0) {
+		fprintf(stderr, "Error while creating the shared memory %s! Error: %s\n", name, strerror(errno));
+		return -1;
+	}
+
+	size_t size = adsShmSize(ringSize);
+	if (ftruncate(fd, size) < 0) {
+		fprintf(stderr, "Error while sizing the shared memory %s! Error: %s\n", name, strerror(errno));
+		close(fd);
+		shm_unlink(name);
+		return -1;
+	}
+
+	void* map = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+	close(fd);
+	if (map == MAP_FAILED) {
+		fprintf(stderr, "Error while mapping the shared memory %s! Error: %s\n", name, strerror(errno));
+		shm_unlink(name);
+		return -1;
+	}
+
+	// ftruncate() zero-fills, so every sample starts invalid
+	m_header = (adsShmHeader_t*)map;
+	m_size = size;
+	m_sequence = 0;
+	snprintf(m_name, sizeof(m_name), "%s", name);
+	m_header->version = ADS_SHM_VERSION;
+	m_header->ringSize = ringSize;
+	m_header->sequence.store(0, std::memory_order_relaxed);
+
+	return 1;
+}
+
+/**************************************************************************/
+/*!
+	@brief  Adds a channel to the channel table
+
+	@param i2cDeviceName bus of the device
+	@param i2cAddress I2C address of the device
+	@param adsType tla2024, ads1015 or ads1115
+	@param input ADS_INPUT_* multiplexer setting
+	@param gain gain setting of the channel
+	@param sps sample rate setting of the channel
+
+	@return the channel index, -1 if the table is full
+*/
+/**************************************************************************/
+int adsShmWriter::addChannel(const char* i2cDeviceName, uint8_t i2cAddress, uint8_t adsType,
+	uint8_t input, adsGain_t gain, adsSps_t sps) {
+	if (!m_header || m_header->channelCount >= ADS_SHM_MAX_CHANNELS)
+		return -1;
+
+	adsShmChannel_t* channel = &m_header->channels[m_header->channelCount];
+	snprintf(channel->i2cDeviceName, sizeof(channel->i2cDeviceName), "%s", i2cDeviceName);
+	channel->i2cAddress = i2cAddress;
+	channel->adsType = adsType;
+	channel->input = input;
+	channel->gain = gain;
+	channel->sps = sps;
+
+	return m_header->channelCount++;
+}
+
+/**************************************************************************/
+/*!
+	@brief  Makes the segment visible to the readers, the channel table
+			must not change afterwards
+*/
+/**************************************************************************/
+void adsShmWriter::publishChannels() {
+	if (!m_header)
+		return;
+
+	std::atomic_thread_fence(std::memory_order_release);
+	m_header->magic = ADS_SHM_MAGIC;
+}
+
+/**************************************************************************/
+/*!
+	@brief  Unmaps and removes the shared memory object.  Readers keep
+			their mapping but no longer receive updates.
+*/
+/**************************************************************************/
+void adsShmWriter::destroy() {
+	if (!m_header)
+		return;
+
+	munmap(m_header, m_size);
+	shm_unlink(m_name);
+	m_header = NULL;
+	m_size = 0;
+}
+
+/**************************************************************************/
+/*!
+	@brief  Opens a write section, readers retry until endUpdate().
+			A whole scan should be published in a single section.
+*/
+/**************************************************************************/
+void adsShmWriter::beginUpdate() {
+	if (!m_header)
+		return;
+
+	m_header->sequence.store(++m_sequence, std::memory_order_relaxed);
+	std::atomic_thread_fence(std::memory_order_release);
+}
+
+/**************************************************************************/
+/*!
+	@brief  Publishes a sample as the latest value of its channel and
+			appends it to the history ring.  Must be called between
+			beginUpdate() and endUpdate().
+
+	@param channel channel index returned by addChannel()
+	@param value ADC code
+	@param timestampNs time of the conversion, see adsTimestampNs()
+*/
+/**************************************************************************/
+void adsShmWriter::publish(uint8_t channel, int16_t value, uint64_t timestampNs) {
+	if (!m_header || channel >= m_header->channelCount)
+		return;
+
+	adsShmSample_t sample;
+	sample.timestampNs = timestampNs;
+	sample.value = value;
+	sample.channel = channel;
+	sample.valid = 1;
+	sample.reserved = 0;
+
+	m_header->latest[channel] = sample;
+	adsShmRing(m_header)[m_header->ringHead & (m_header->ringSize - 1)] = sample;
+	m_header->ringHead++;
+}
+
+/**************************************************************************/
+/*!
+	@brief  Closes the write section opened by beginUpdate()
+*/
+/**************************************************************************/
+void adsShmWriter::endUpdate() {
+	if (!m_header)
+		return;
+
+	m_header->sequence.store(++m_sequence, std::memory_order_release);
+}
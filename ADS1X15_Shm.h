@@ -0,0 +1,45 @@
+/**************************************************************************/
+/*!
+    @file     ADS1X15_Shm.h
+
+    Daemon side of the sampling shared memory, see ADS1X15_ShmClient.h
+    for the layout and the reader.
+
+    @section license License
+
+    BSD license, all text here must be included in any redistribution
+*/
+/**************************************************************************/
+
+#ifndef ADS1X15_SHM_H
+#define ADS1X15_SHM_H
+
+#include "ADS1X15_ShmClient.h"
+#include "ADS1X15_TLA2024.h"
+
+/**************************************************************************/
+/*!
+    @brief  Single writer of the sampling shared memory
+*/
+/**************************************************************************/
+class adsShmWriter {
+public:
+    adsShmWriter();
+    ~adsShmWriter();
+    int  create(const char* name, uint32_t ringSize);
+    int  addChannel(const char* i2cDeviceName, uint8_t i2cAddress, uint8_t adsType,
+                    uint8_t input, adsGain_t gain, adsSps_t sps);
+    void publishChannels(void);
+    void destroy(void);
+    void beginUpdate(void);
+    void publish(uint8_t channel, int16_t value, uint64_t timestampNs);
+    void endUpdate(void);
+
+private:
+    adsShmHeader_t* m_header;
+    size_t          m_size;
+    char            m_name[64];
+    uint32_t        m_sequence;
+};
+
+#endif // ADS1X15_SHM_H
@@ -0,0 +1,288 @@
+/**************************************************************************/
+/*!
+    @file     ADS1X15_ShmClient.h
+
+    Client side of the sampling daemon shared memory.
+
+    A single daemon owns the I2C bus and publishes the latest sample of
+    every channel plus a history ring into a POSIX shared memory object.
+    Readers never block the daemon: every read is a seqlock protected
+    copy that is retried if the daemon updated the segment meanwhile.
+    A read fails instead of spinning forever if the daemon died in the
+    middle of an update.
+
+    This header has no dependency on the driver and can be used alone
+    (link with -lrt on older glibc).
+
+    @section license License
+
+    BSD license, all text here must be included in any redistribution
+*/
+/**************************************************************************/
+
+#ifndef ADS1X15_SHMCLIENT_H
+#define ADS1X15_SHMCLIENT_H
+
+#include <atomic>
+#include <fcntl.h>
+#include <sched.h>
+#include <stdint.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+/*=========================================================================
+    SHARED MEMORY LAYOUT
+    -----------------------------------------------------------------------*/
+#define ADS_SHM_DEFAULT_NAME  "/ads1x15"  ///< Default shared memory object
+#define ADS_SHM_MAGIC         (0x41445331) ///< "ADS1"
+#define ADS_SHM_VERSION       (1)          ///< Layout version
+#define ADS_SHM_MAX_CHANNELS  (32)         ///< Channels published by one daemon
+#define ADS_SHM_BUS_NAME_SIZE (32)         ///< Bus name stored per channel
+/*=========================================================================*/
+
+/*=========================================================================
+    READER SETTINGS
+    -----------------------------------------------------------------------*/
+#define ADS_SHM_WAIT_SPINS    (10000) ///< Yields waiting for the daemon to leave the write section
+#define ADS_SHM_READ_TRIES    (100)   ///< Copies retried while the daemon keeps writing
+/*=========================================================================*/
+
+/** One sample as published by the daemon */
+typedef struct {
+    uint64_t timestampNs; ///< CLOCK_MONOTONIC time of the conversion
+    int16_t  value;       ///< ADC code
+    uint8_t  channel;     ///< index in the channel table
+    uint8_t  valid;       ///< 0 until the first conversion of the channel
+    uint32_t reserved;
+} adsShmSample_t;
+
+/** Description of a published channel */
+typedef struct {
+    char    i2cDeviceName[ADS_SHM_BUS_NAME_SIZE]; ///< bus of the device
+    uint8_t i2cAddress;                           ///< I2C address of the device
+    uint8_t adsType;                              ///< tla2024, ads1015 or ads1115
+    uint8_t input;                                ///< ADS_INPUT_* multiplexer setting
+    uint8_t reserved;
+    uint16_t gain;                                ///< adsGain_t
+    uint16_t sps;                                 ///< adsSps_t
+} adsShmChannel_t;
+
+/** Start of the shared memory object, the history ring follows */
+typedef struct {
+    uint32_t magic;                 ///< ADS_SHM_MAGIC once initialized
+    uint32_t version;               ///< ADS_SHM_VERSION
+    uint32_t channelCount;          ///< channels in use
+    uint32_t ringSize;              ///< history ring entries, power of 2
+    std::atomic<uint32_t> sequence; ///< seqlock, odd while the daemon writes
+    uint32_t reserved;
+    uint64_t ringHead;              ///< samples written to the ring so far
+    adsShmChannel_t channels[ADS_SHM_MAX_CHANNELS];
+    adsShmSample_t  latest[ADS_SHM_MAX_CHANNELS];
+} adsShmHeader_t;
+
+/**************************************************************************/
+/*!
+    @brief  Size of the shared memory object
+
+    @param ringSize history ring entries
+*/
+/**************************************************************************/
+inline size_t adsShmSize(uint32_t ringSize) {
+    return sizeof(adsShmHeader_t) + (size_t)ringSize * sizeof(adsShmSample_t);
+}
+
+/**************************************************************************/
+/*!
+    @brief  History ring of the shared memory object
+*/
+/**************************************************************************/
+inline adsShmSample_t* adsShmRing(adsShmHeader_t* header) {
+    return (adsShmSample_t*)(header + 1);
+}
+
+/**************************************************************************/
+/*!
+    @brief  Lock-free reader of the sampling daemon shared memory
+*/
+/**************************************************************************/
+class adsShmReader {
+public:
+    adsShmReader() : m_header(NULL), m_size(0) {}
+    ~adsShmReader() { close(); }
+
+    /**************************************************************************/
+    /*!
+        @brief  Maps the shared memory object read-only
+
+        @param name shared memory object name
+
+        @return 1 on success, -1 if the daemon is not running
+    */
+    /**************************************************************************/
+    int open(const char* name = ADS_SHM_DEFAULT_NAME) {
+        close();
+
+        int fd = shm_open(name, O_RDONLY, 0);
+        if (fd < 0)
+            return -1;
+
+        struct stat st;
+        if (fstat(fd, &st) < 0 || (size_t)st.st_size < sizeof(adsShmHeader_t)) {
+            ::close(fd);
+            return -1;
+        }
+
+        void* map = mmap(NULL, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+        ::close(fd);
+        if (map == MAP_FAILED)
+            return -1;
+
+        m_header = (adsShmHeader_t*)map;
+        m_size = st.st_size;
+        if (m_header->magic != ADS_SHM_MAGIC || m_header->version != ADS_SHM_VERSION ||
+            adsShmSize(m_header->ringSize) > m_size) {
+            close();
+            return -1;
+        }
+
+        return 1;
+    }
+
+    /**************************************************************************/
+    /*!
+        @brief  Unmaps the shared memory object
+    */
+    /**************************************************************************/
+    void close() {
+        if (m_header)
+            munmap(m_header, m_size);
+        m_header = NULL;
+        m_size = 0;
+    }
+
+    /** @return the number of published channels */
+    uint32_t channelCount() const { return m_header ? m_header->channelCount : 0; }
+
+    /**************************************************************************/
+    /*!
+        @brief  Copies the description of a channel
+
+        @return false if the channel is not published
+    */
+    /**************************************************************************/
+    bool channel(uint32_t index, adsShmChannel_t& channel) const {
+        if (index >= channelCount())
+            return false;
+
+        // The channel table is written once before the magic
+        channel = m_header->channels[index];
+        return true;
+    }
+
+    /**************************************************************************/
+    /*!
+        @brief  Reads the latest sample of a channel
+
+        @return false if the channel is not published, not converted yet
+                or the daemon stopped in the middle of an update
+    */
+    /**************************************************************************/
+    bool readLatest(uint32_t index, adsShmSample_t& sample) const {
+        if (index >= channelCount())
+            return false;
+
+        for (int tries = 0; tries < ADS_SHM_READ_TRIES; tries++)
+        {
+            uint32_t seq;
+            if (!readBegin(seq))
+                return false;
+            sample = m_header->latest[index];
+            if (readRetry(seq))
+                return sample.valid != 0;
+        }
+
+        return false;
+    }
+
+    /**************************************************************************/
+    /*!
+        @brief  Reads the history ring from a cursor.  If the reader fell
+                behind by more than the ring size, the oldest samples are
+                skipped and the cursor jumps forward.  A cursor past the
+                head (the daemon restarted) is moved back to the head.
+
+        @param cursor ring position, 0 on the first call, updated
+        @param samples output samples
+        @param maxSamples size of samples
+
+        @return the number of samples copied, 0 if the daemon stopped in
+                the middle of an update
+    */
+    /**************************************************************************/
+    size_t readHistory(uint64_t& cursor, adsShmSample_t* samples, size_t maxSamples) const {
+        if (!m_header)
+            return 0;
+
+        const adsShmSample_t* ring = adsShmRing(m_header);
+        uint32_t mask = m_header->ringSize - 1;
+        for (int tries = 0; tries < ADS_SHM_READ_TRIES; tries++)
+        {
+            uint32_t seq;
+            if (!readBegin(seq))
+                return 0;
+
+            uint64_t head = m_header->ringHead;
+            uint64_t from = cursor > head ? head : cursor;
+            if (head - from > m_header->ringSize)
+                from = head - m_header->ringSize;
+            size_t count = (size_t)(head - from);
+            if (count > maxSamples)
+                count = maxSamples;
+            for (size_t i = 0; i < count; i++)
+                samples[i] = ring[(from + i) & mask];
+
+            if (readRetry(seq)) {
+                cursor = from + count;
+                return count;
+            }
+        }
+
+        return 0;
+    }
+
+private:
+    /**************************************************************************/
+    /*!
+        @brief  Waits for the daemon to leave the write section, yielding
+                the CPU to it
+
+        @param seq sequence to check in readRetry()
+
+        @return false if the daemon did not finish its update in time
+    */
+    /**************************************************************************/
+    bool readBegin(uint32_t& seq) const {
+        for (int spins = 0; spins < ADS_SHM_WAIT_SPINS; spins++)
+        {
+            seq = m_header->sequence.load(std::memory_order_acquire);
+            if (!(seq & 1))
+                return true;
+            sched_yield();
+        }
+
+        return false;
+    }
+
+    /** @return true if no write happened since readBegin() */
+    bool readRetry(uint32_t seq) const {
+        std::atomic_thread_fence(std::memory_order_acquire);
+        return m_header->sequence.load(std::memory_order_relaxed) == seq;
+    }
+
+    adsShmHeader_t* m_header;
+    size_t m_size;
+};
+
+#endif // ADS1X15_SHMCLIENT_H
@@ -0,0 +1,493 @@
+/**************************************************************************/
+/*!
+	@file     ADS1X15_Spectrum.cpp
+
+	Streaming spectral stage for ripple and vibration monitoring.
+
+	@section license License
+
+	BSD license, all text here must be included in any redistribution
+*/
+/**************************************************************************/
+
+#include <math.h>
+
+#include "ADS1X15_Spectrum.h"
+
+// Define ADS_SPECTRUM_SCALAR to build the portable kernel only
+#if !defined(ADS_SPECTRUM_SCALAR) && defined(__SSE__)
+#include <xmmintrin.h>
+#define ADS_SPECTRUM_SSE
+#elif !defined(ADS_SPECTRUM_SCALAR) && defined(__ARM_NEON)
+#include <arm_neon.h>
+#define ADS_SPECTRUM_NEON
+#endif
+
+/**************************************************************************/
+/*!
+	@brief  Radix-2 butterflies of one group: a += W b, b = a - W b, on
+			split real/imaginary arrays
+
+	@param count butterflies in the group, a power of two
+*/
+/**************************************************************************/
+static void butterflies(float* ar, float* ai, float* br, float* bi, const float* wr, const float* wi, size_t count) {
+	size_t k = 0;
+#if defined(ADS_SPECTRUM_SSE)
+	for (; k + 4 <= count; k += 4)
+	{
+		__m128 xr = _mm_loadu_ps(br + k), xi = _mm_loadu_ps(bi + k);
+		__m128 cr = _mm_loadu_ps(wr + k), ci = _mm_loadu_ps(wi + k);
+		__m128 tr = _mm_sub_ps(_mm_mul_ps(xr, cr), _mm_mul_ps(xi, ci));
+		__m128 ti = _mm_add_ps(_mm_mul_ps(xr, ci), _mm_mul_ps(xi, cr));
+		__m128 yr = _mm_loadu_ps(ar + k), yi = _mm_loadu_ps(ai + k);
+		_mm_storeu_ps(br + k, _mm_sub_ps(yr, tr));
+		_mm_storeu_ps(bi + k, _mm_sub_ps(yi, ti));
+		_mm_storeu_ps(ar + k, _mm_add_ps(yr, tr));
+		_mm_storeu_ps(ai + k, _mm_add_ps(yi, ti));
+	}
+#elif defined(ADS_SPECTRUM_NEON)
+	for (; k + 4 <= count; k += 4)
+	{
+		float32x4_t xr = vld1q_f32(br + k), xi = vld1q_f32(bi + k);
+		float32x4_t cr = vld1q_f32(wr + k), ci = vld1q_f32(wi + k);
+		float32x4_t tr = vsubq_f32(vmulq_f32(xr, cr), vmulq_f32(xi, ci));
+		float32x4_t ti = vaddq_f32(vmulq_f32(xr, ci), vmulq_f32(xi, cr));
+		float32x4_t yr = vld1q_f32(ar + k), yi = vld1q_f32(ai + k);
+		vst1q_f32(br + k, vsubq_f32(yr, tr));
+		vst1q_f32(bi + k, vsubq_f32(yi, ti));
+		vst1q_f32(ar + k, vaddq_f32(yr, tr));
+		vst1q_f32(ai + k, vaddq_f32(yi, ti));
+	}
+#endif
+	// First stages (1 and 2 butterflies) and the scalar kernel
+	for (; k < count; k++)
+	{
+		float tr = br[k] * wr[k] - bi[k] * wi[k];
+		float ti = br[k] * wi[k] + bi[k] * wr[k];
+		br[k] = ar[k] - tr;
+		bi[k] = ai[k] - ti;
+		ar[k] += tr;
+		ai[k] += ti;
+	}
+}
+
+/**************************************************************************/
+/*!
+	@brief  Instantiates the stage and precomputes the window, twiddles
+			and buffers
+
+	@param channelCount number of channels, samples of other channels are
+			ignored
+	@param fftSize frame length, rounded up to a power of two between
+			ADS_SPECTRUM_MIN_SIZE and ADS_SPECTRUM_MAX_SIZE
+	@param overlap samples shared by two consecutive frames, less than the
+			frame length
+*/
+/**************************************************************************/
+adsSpectrum::adsSpectrum(size_t channelCount, size_t fftSize, size_t overlap)
+{
+	m_size = ADS_SPECTRUM_MIN_SIZE;
+	while (m_size < fftSize && m_size < ADS_SPECTRUM_MAX_SIZE)
+		m_size <<= 1;
+	m_half = m_size / 2;
+	m_hop = overlap < m_size ? m_size - overlap : 1;
+	m_rateHz = 1;
+
+	// Periodic Hann window
+	double sumSquares = 0;
+	m_window.resize(m_size);
+	for (size_t n = 0; n < m_size; n++)
+	{
+		m_window[n] = (float)(0.5 - 0.5 * cos(2 * M_PI * n / m_size));
+		sumSquares += (double)m_window[n] * m_window[n];
+	}
+	m_scale = (float)(1.0 / (m_size * sumSquares));
+
+	size_t bits = 0;
+	while (((size_t)1 << bits) < m_half)
+		bits++;
+	m_reverse.resize(m_half);
+	for (size_t n = 0; n < m_half; n++)
+	{
+		uint32_t reversed = 0;
+		for (size_t b = 0; b < bits; b++)
+			if (n & ((size_t)1 << b))
+				reversed |= 1u << (bits - 1 - b);
+		m_reverse[n] = reversed;
+	}
+
+	// Stage with groups of h butterflies: W = exp(-i pi k / h) at offset h - 1
+	m_twiddleRe.resize(m_half);
+	m_twiddleIm.resize(m_half);
+	for (size_t h = 1; h < m_half; h <<= 1)
+	{
+		for (size_t k = 0; k < h; k++)
+		{
+			m_twiddleRe[h - 1 + k] = (float)cos(M_PI * k / h);
+			m_twiddleIm[h - 1 + k] = (float)-sin(M_PI * k / h);
+		}
+	}
+
+	m_splitRe.resize(m_half + 1);
+	m_splitIm.resize(m_half + 1);
+	for (size_t k = 0; k <= m_half; k++)
+	{
+		m_splitRe[k] = (float)cos(2 * M_PI * k / m_size);
+		m_splitIm[k] = (float)sin(2 * M_PI * k / m_size);
+	}
+
+	m_re.resize(m_half);
+	m_im.resize(m_half);
+
+	m_channels.resize(channelCount);
+	for (size_t i = 0; i < m_channels.size(); i++)
+	{
+		m_channels[i].history.resize(m_size);
+		m_channels[i].power.resize(m_half + 1);
+	}
+	reset();
+}
+
+/**************************************************************************/
+/*!
+	@brief  Sets the sample rate of every channel, used for the band
+			limits and the peak frequencies.  It is 1 by default, the
+			frequencies are then in cycles per sample.
+
+	@param rateHz samples per second of one channel
+*/
+/**************************************************************************/
+void adsSpectrum::setSampleRate(double rateHz) {
+	if (rateHz > 0)
+		m_rateHz = rateHz;
+}
+
+/**************************************************************************/
+/*!
+	@brief  Adds a band whose energy is reported, before the samples are
+			fed.  The band holds the bins from lowHz to highHz included.
+
+	@return the band index, -1 on error
+*/
+/**************************************************************************/
+int adsSpectrum::addBand(double lowHz, double highHz) {
+	if (lowHz < 0 || highHz < lowHz)
+		return -1;
+
+	band_t band;
+	band.lowHz = lowHz;
+	band.highHz = highHz;
+	m_bands.push_back(band);
+	for (size_t i = 0; i < m_channels.size(); i++)
+		m_channels[i].bands.push_back(0);
+
+	return m_bands.size() - 1;
+}
+
+/**************************************************************************/
+/*!
+	@brief  Adds a stage notified after each frame
+
+	@param sink stage to notify, must outlive the spectrum
+*/
+/**************************************************************************/
+void adsSpectrum::addSink(adsSpectrumSink* sink) {
+	m_sinks.push_back(sink);
+}
+
+/**************************************************************************/
+/*!
+	@brief  Feeds a sample to its channel
+*/
+/**************************************************************************/
+void adsSpectrum::onSample(const adsSample_t& sample) {
+	if (sample.channel < m_channels.size())
+		push(sample.channel, sample.value);
+}
+
+/**************************************************************************/
+/*!
+	@brief  Feeds every row of a filled block, block channel i to channel i
+
+	@return the number of samples fed
+*/
+/**************************************************************************/
+size_t adsSpectrum::addBlock(const adsSampleBlock& block) {
+	size_t channels = block.channelCount() < m_channels.size() ? block.channelCount() : m_channels.size();
+	size_t rows = block.size();
+	for (size_t c = 0; c < channels; c++)
+	{
+		const int16_t* column = block.column(c);
+		for (size_t r = 0; r < rows; r++)
+			push(c, column[r]);
+	}
+
+	return channels * rows;
+}
+
+/**************************************************************************/
+/*!
+	@brief  Forgets the samples and results of every channel
+*/
+/**************************************************************************/
+void adsSpectrum::reset() {
+	for (size_t i = 0; i < m_channels.size(); i++)
+	{
+		channel_t* channel = &m_channels[i];
+		channel->head = 0;
+		channel->count = 0;
+		channel->pending = 0;
+		channel->frames = 0;
+		channel->peakCount = 0;
+		channel->power.assign(channel->power.size(), 0);
+		channel->bands.assign(channel->bands.size(), 0);
+	}
+}
+
+/**************************************************************************/
+/*!
+	@brief  Stores a sample and runs a frame every hop samples once the
+			history is full
+*/
+/**************************************************************************/
+void adsSpectrum::push(uint8_t index, int16_t value) {
+	channel_t* channel = &m_channels[index];
+	channel->history[channel->head] = value;
+	channel->head = (channel->head + 1) & (m_size - 1);
+	if (channel->count < m_size)
+		channel->count++;
+
+	if (++channel->pending >= m_hop && channel->count == m_size) {
+		channel->pending = 0;
+		frame(index);
+	}
+}
+
+/**************************************************************************/
+/*!
+	@brief  Windows the history of a channel, transforms it and notifies
+			the sinks
+*/
+/**************************************************************************/
+void adsSpectrum::frame(uint8_t index) {
+	channel_t* channel = &m_channels[index];
+
+	// Even samples in the real part, odd ones in the imaginary part, the
+	// oldest sample is at head
+	for (size_t n = 0; n < m_half; n++)
+	{
+		size_t even = (channel->head + 2 * n) & (m_size - 1);
+		size_t odd = (channel->head + 2 * n + 1) & (m_size - 1);
+		size_t slot = m_reverse[n];
+		m_re[slot] = channel->history[even] * m_window[2 * n];
+		m_im[slot] = channel->history[odd] * m_window[2 * n + 1];
+	}
+
+	transform();
+	analyse(channel);
+	channel->frames++;
+
+	for (size_t i = 0; i < m_sinks.size(); i++)
+		m_sinks[i]->onSpectrum(*this, index);
+}
+
+/**************************************************************************/
+/*!
+	@brief  In-place complex FFT of the bit reversed work buffers
+*/
+/**************************************************************************/
+void adsSpectrum::transform() {
+	float* re = &m_re[0];
+	float* im = &m_im[0];
+	for (size_t h = 1; h < m_half; h <<= 1)
+	{
+		const float* wr = &m_twiddleRe[h - 1];
+		const float* wi = &m_twiddleIm[h - 1];
+		for (size_t start = 0; start < m_half; start += 2 * h)
+			butterflies(re + start, im + start, re + start + h, im + start + h, wr, wi, h);
+	}
+}
+
+/**************************************************************************/
+/*!
+	@brief  Real split step to the one-sided power spectrum, then the
+			band energies and peaks of the frame
+*/
+/**************************************************************************/
+void adsSpectrum::analyse(channel_t* channel) {
+	float* power = &channel->power[0];
+	for (size_t k = 0; k <= m_half; k++)
+	{
+		// X[k] = (Z[k] + conj Z[M-k]) / 2 + W^k (Z[k] - conj Z[M-k]) / 2i
+		size_t a = k < m_half ? k : 0;
+		size_t b = k ? m_half - k : 0;
+		float evenRe = 0.5f * (m_re[a] + m_re[b]);
+		float evenIm = 0.5f * (m_im[a] - m_im[b]);
+		float oddRe = 0.5f * (m_im[a] + m_im[b]);
+		float oddIm = -0.5f * (m_re[a] - m_re[b]);
+		float c = m_splitRe[k];
+		float s = m_splitIm[k];
+		float re = evenRe + c * oddRe + s * oddIm;
+		float im = evenIm + c * oddIm - s * oddRe;
+		float bin = (re * re + im * im) * m_scale;
+		power[k] = k && k < m_half ? 2 * bin : bin;
+	}
+
+	double binHz = m_rateHz / m_size;
+	for (size_t i = 0; i < m_bands.size(); i++)
+	{
+		size_t low = (size_t)ceil(m_bands[i].lowHz / binHz - 1e-9);
+		double high = floor(m_bands[i].highHz / binHz + 1e-9);
+		size_t last = high < m_half ? (size_t)high : m_half;
+		double energy = 0;
+		for (size_t k = low; k <= last; k++)
+			energy += power[k];
+		channel->bands[i] = energy;
+	}
+
+	// Strongest local maxima, sorted by power
+	channel->peakCount = 0;
+	for (size_t k = 1; k < m_half; k++)
+	{
+		if (power[k] <= power[k - 1] || power[k] < power[k + 1])
+			continue;
+
+		size_t slot = channel->peakCount;
+		if (slot < ADS_SPECTRUM_PEAKS) {
+			channel->peakCount++;
+		}
+		else {
+			// Replaces the weakest peak
+			if (power[k] <= channel->peaks[slot - 1].power)
+				continue;
+			slot--;
+		}
+		for (; slot > 0 && channel->peaks[slot - 1].power < power[k]; slot--)
+			channel->peaks[slot] = channel->peaks[slot - 1];
+
+		// Parabola through the bin and its neighbours
+		double curvature = power[k - 1] - 2.0 * power[k] + power[k + 1];
+		double offset = curvature != 0 ? 0.5 * (power[k - 1] - power[k + 1]) / curvature : 0;
+		channel->peaks[slot].bin = k;
+		channel->peaks[slot].frequencyHz = (k + offset) * binHz;
+		channel->peaks[slot].power = power[k];
+	}
+}
+
+/**************************************************************************/
+/*!
+	@brief  Gets the frame length
+*/
+/**************************************************************************/
+size_t adsSpectrum::fftSize() const {
+	return m_size;
+}
+
+/**************************************************************************/
+/*!
+	@brief  Gets the number of new samples between two frames
+*/
+/**************************************************************************/
+size_t adsSpectrum::hop() const {
+	return m_hop;
+}
+
+/**************************************************************************/
+/*!
+	@brief  Gets the number of bins of the power spectrum, DC to Nyquist
+*/
+/**************************************************************************/
+size_t adsSpectrum::binCount() const {
+	return m_half + 1;
+}
+
+/**************************************************************************/
+/*!
+	@brief  Gets the width of a bin in Hz
+*/
+/**************************************************************************/
+double adsSpectrum::binHz() const {
+	return m_rateHz / m_size;
+}
+
+/**************************************************************************/
+/*!
+	@brief  Gets the number of bands
+*/
+/**************************************************************************/
+size_t adsSpectrum::bandCount() const {
+	return m_bands.size();
+}
+
+/**************************************************************************/
+/*!
+	@brief  Gets the number of frames computed for a channel
+*/
+/**************************************************************************/
+uint64_t adsSpectrum::frames(uint8_t channel) const {
+	return channel < m_channels.size() ? m_channels[channel].frames : 0;
+}
+
+/**************************************************************************/
+/*!
+	@brief  Gets the power spectrum of the last frame of a channel
+
+	@return binCount() bins in code^2, NULL if the channel is out of range
+*/
+/**************************************************************************/
+const float* adsSpectrum::power(uint8_t channel) const {
+	return channel < m_channels.size() ? &m_channels[channel].power[0] : NULL;
+}
+
+/**************************************************************************/
+/*!
+	@brief  Gets the energy of a band in the last frame of a channel
+
+	@return the mean square in code^2, its square root is the RMS
+*/
+/**************************************************************************/
+double adsSpectrum::bandEnergy(uint8_t channel, size_t band) const {
+	if (channel >= m_channels.size() || band >= m_bands.size())
+		return 0;
+
+	return m_channels[channel].bands[band];
+}
+
+/**************************************************************************/
+/*!
+	@brief  Gets the strongest peaks of the last frame of a channel
+
+	@param peaks output, strongest first
+	@param maxPeaks size of peaks
+
+	@return the number of peaks written
+*/
+/**************************************************************************/
+size_t adsSpectrum::peaks(uint8_t channel, adsSpectrumPeak_t* peaks, size_t maxPeaks) const {
+	if (channel >= m_channels.size())
+		return 0;
+
+	size_t count = m_channels[channel].peakCount < maxPeaks ? m_channels[channel].peakCount : maxPeaks;
+	for (size_t i = 0; i < count; i++)
+		peaks[i] = m_channels[channel].peaks[i];
+
+	return count;
+}
+
+/**************************************************************************/
+/*!
+	@brief  Gets the name of the butterfly kernel built in
+
+	@return "sse", "neon" or "scalar"
+*/
+/**************************************************************************/
+const char* adsSpectrum::kernel() {
+#if defined(ADS_SPECTRUM_SSE)
+	return "sse";
+#elif defined(ADS_SPECTRUM_NEON)
+	return "neon";
+#else
+	return "scalar";
+#endif
+}
@@ -0,0 +1,132 @@
+/**************************************************************************/
+/*!
+    @file     ADS1X15_Spectrum.h
+
+    Streaming spectral stage for ripple and vibration monitoring.
+
+    Each channel keeps the last N samples. Every hop samples (N minus the
+    overlap) a frame is Hann windowed and transformed with a real FFT:
+    a complex radix-2 FFT of N/2 points on split real/imaginary arrays
+    followed by the real split step. The twiddles, window, bit reversal
+    table and work buffers are allocated once; the butterflies run on 4
+    floats at a time with SSE or NEON (define ADS_SPECTRUM_SCALAR for the
+    portable kernel).
+
+    Each frame gives the one-sided power spectrum in code^2 (mean square,
+    window compensated, so a sine of amplitude A shows A^2/2 in its band),
+    the energy of each band and the strongest peaks, then notifies the
+    spectrum sinks. Frames run incrementally as samples arrive, from
+    onSample() or addBlock().
+
+    @section license License
+
+    BSD license, all text here must be included in any redistribution
+*/
+/**************************************************************************/
+
+#ifndef ADS1X15_SPECTRUM_H
+#define ADS1X15_SPECTRUM_H
+
+#include <vector>
+
+#include "ADS1X15_SampleBlock.h"
+
+/*=========================================================================
+    SPECTRUM SETTINGS
+    -----------------------------------------------------------------------*/
+#define ADS_SPECTRUM_MIN_SIZE     (16)    ///< Smallest FFT length
+#define ADS_SPECTRUM_MAX_SIZE     (65536) ///< Largest FFT length
+#define ADS_SPECTRUM_DEFAULT_SIZE (256)   ///< Default FFT length
+#define ADS_SPECTRUM_PEAKS        (4)     ///< Peaks kept per channel
+/*=========================================================================*/
+
+/** Spectral peak of a frame */
+typedef struct {
+    size_t bin;          ///< bin of the local maximum
+    double frequencyHz;  ///< interpolated between the neighbour bins
+    double power;        ///< power of the bin in code^2
+} adsSpectrumPeak_t;
+
+class adsSpectrum;
+
+/**************************************************************************/
+/*!
+    @brief  Stage notified after each frame of a channel
+*/
+/**************************************************************************/
+class adsSpectrumSink {
+public:
+    virtual ~adsSpectrumSink() {}
+    virtual void onSpectrum(const adsSpectrum& spectrum, uint8_t channel) = 0; ///< Called after every frame
+};
+
+/**************************************************************************/
+/*!
+    @brief  Windowed, overlapped real FFT of every channel
+*/
+/**************************************************************************/
+class adsSpectrum : public adsSampleSink {
+public:
+    adsSpectrum(size_t channelCount = ADS_INPUT_COUNT, size_t fftSize = ADS_SPECTRUM_DEFAULT_SIZE, size_t overlap = ADS_SPECTRUM_DEFAULT_SIZE / 2);
+    void   setSampleRate(double rateHz);
+    int    addBand(double lowHz, double highHz);
+    void   addSink(adsSpectrumSink* sink);
+    void   onSample(const adsSample_t& sample);
+    size_t addBlock(const adsSampleBlock& block);
+    void   reset(void);
+
+    size_t   fftSize(void) const;
+    size_t   hop(void) const;
+    size_t   binCount(void) const;
+    double   binHz(void) const;
+    size_t   bandCount(void) const;
+    uint64_t frames(uint8_t channel) const;
+    const float* power(uint8_t channel) const;
+    double   bandEnergy(uint8_t channel, size_t band) const;
+    size_t   peaks(uint8_t channel, adsSpectrumPeak_t* peaks, size_t maxPeaks) const;
+    static const char* kernel(void);
+
+private:
+    typedef struct {
+        std::vector<float>  history;  ///< last fftSize samples, circular
+        size_t              head;     ///< next position written
+        size_t              count;    ///< samples in the history, up to fftSize
+        size_t              pending;  ///< samples since the last frame
+        uint64_t            frames;
+        std::vector<float>  power;    ///< binCount bins of the last frame
+        std::vector<double> bands;
+        adsSpectrumPeak_t   peaks[ADS_SPECTRUM_PEAKS];
+        size_t              peakCount;
+    } channel_t;
+
+    typedef struct {
+        double lowHz;
+        double highHz;
+    } band_t;
+
+    adsSpectrum(const adsSpectrum&);
+    adsSpectrum& operator=(const adsSpectrum&);
+    void push(uint8_t channel, int16_t value);
+    void frame(uint8_t channel);
+    void transform(void);
+    void analyse(channel_t* channel);
+
+    size_t                 m_size;      ///< real FFT length N
+    size_t                 m_half;      ///< complex FFT length N/2
+    size_t                 m_hop;
+    double                 m_rateHz;
+    std::vector<float>     m_window;
+    float                  m_scale;     ///< one-sided power scale of a bin
+    std::vector<uint32_t>  m_reverse;   ///< bit reversal of the N/2 indexes
+    std::vector<float>     m_twiddleRe; ///< per stage, W of the stage for k = 0..m-1
+    std::vector<float>     m_twiddleIm;
+    std::vector<float>     m_splitRe;   ///< cos/sin(2 pi k / N) of the real split step
+    std::vector<float>     m_splitIm;
+    std::vector<float>     m_re;        ///< work buffers
+    std::vector<float>     m_im;
+    std::vector<channel_t> m_channels;
+    std::vector<band_t>    m_bands;
+    std::vector<adsSpectrumSink*> m_sinks;
+};
+
+#endif // ADS1X15_SPECTRUM_H
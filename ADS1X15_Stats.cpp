@@ -0,0 +1,322 @@
+/**************************************************************************/
+/*!
+	@file     ADS1X15_Stats.cpp
+
+	Incremental per-channel statistics computed at acquisition time.
+
+	@section license License
+
+	BSD license, all text here must be included in any redistribution
+*/
+/**************************************************************************/
+
+#include <math.h>
+
+#include "ADS1X15_Stats.h"
+
+/**************************************************************************/
+/*!
+	@brief  Instantiates empty statistics
+
+	@param window sliding window length in samples
+*/
+/**************************************************************************/
+adsChannelStats::adsChannelStats(size_t window)
+{
+	setWindow(window);
+}
+
+/**************************************************************************/
+/*!
+	@brief  Changes the sliding window length, the statistics are reset
+
+	@param window sliding window length in samples
+*/
+/**************************************************************************/
+void adsChannelStats::setWindow(size_t window) {
+	if (window == 0)
+		window = 1;
+
+	m_ring.assign(window, 0);
+	m_minDeque.positions.assign(window, 0);
+	m_maxDeque.positions.assign(window, 0);
+	reset();
+}
+
+/**************************************************************************/
+/*!
+	@brief  Forgets every sample, the window length is kept
+*/
+/**************************************************************************/
+void adsChannelStats::reset() {
+	m_count = 0;
+	m_mean = 0;
+	m_m2 = 0;
+	m_min = INT16_MAX;
+	m_max = INT16_MIN;
+	m_sum = 0;
+	m_sumSquares = 0;
+	m_minDeque.head = 0;
+	m_minDeque.size = 0;
+	m_maxDeque.head = 0;
+	m_maxDeque.size = 0;
+}
+
+/**************************************************************************/
+/*!
+	@brief  Pushes a sample position at the back of a monotonic deque,
+			dropping the entries it dominates
+
+	@param deque deque to update
+	@param position position of the new sample, already written to m_ring
+			over the sample leaving the window (popped first below)
+	@param keepMin true for the min deque, false for the max deque
+*/
+/**************************************************************************/
+void adsChannelStats::dequePush(deque_t& deque, uint64_t position, bool keepMin) {
+	size_t window = m_ring.size();
+	int16_t code = m_ring[position % window];
+
+	// The oldest entry leaves the window first, its slot now holds the new code
+	if (deque.size && deque.positions[deque.head] + window <= position) {
+		deque.head = (deque.head + 1) % window;
+		deque.size--;
+	}
+
+	while (deque.size) {
+		size_t back = (deque.head + deque.size - 1) % window;
+		int16_t backCode = m_ring[deque.positions[back] % window];
+		if (keepMin ? backCode < code : backCode > code)
+			break;
+		deque.size--;
+	}
+
+	deque.positions[(deque.head + deque.size) % window] = position;
+	deque.size++;
+}
+
+/**************************************************************************/
+/*!
+	@brief  Adds a sample, O(1)
+
+	@param code ADC code
+*/
+/**************************************************************************/
+void adsChannelStats::add(int16_t code) {
+	size_t window = m_ring.size();
+	uint64_t position = m_count;
+	size_t slot = position % window;
+
+	// Sliding window, exact in integers
+	if (position >= window) {
+		int64_t old = m_ring[slot];
+		m_sum -= old;
+		m_sumSquares -= old * old;
+	}
+	m_ring[slot] = code;
+	m_sum += code;
+	m_sumSquares += (int64_t)code * code;
+	dequePush(m_minDeque, position, true);
+	dequePush(m_maxDeque, position, false);
+
+	// Lifetime, Welford
+	m_count++;
+	double delta = code - m_mean;
+	m_mean += delta / m_count;
+	m_m2 += delta * (code - m_mean);
+	if (code < m_min)
+		m_min = code;
+	if (code > m_max)
+		m_max = code;
+}
+
+/**************************************************************************/
+/*!
+	@brief  Gets the number of samples added since the last reset
+*/
+/**************************************************************************/
+uint64_t adsChannelStats::count() const {
+	return m_count;
+}
+
+/**************************************************************************/
+/*!
+	@brief  Gets the lifetime mean in codes
+*/
+/**************************************************************************/
+double adsChannelStats::mean() const {
+	return m_mean;
+}
+
+/**************************************************************************/
+/*!
+	@brief  Gets the lifetime population variance in codes^2
+*/
+/**************************************************************************/
+double adsChannelStats::variance() const {
+	return m_count ? m_m2 / m_count : 0;
+}
+
+/**************************************************************************/
+/*!
+	@brief  Gets the lifetime population standard deviation in codes
+*/
+/**************************************************************************/
+double adsChannelStats::stddev() const {
+	return sqrt(variance());
+}
+
+/**************************************************************************/
+/*!
+	@brief  Gets the lifetime minimum, INT16_MAX if empty
+*/
+/**************************************************************************/
+int16_t adsChannelStats::min() const {
+	return m_min;
+}
+
+/**************************************************************************/
+/*!
+	@brief  Gets the lifetime maximum, INT16_MIN if empty
+*/
+/**************************************************************************/
+int16_t adsChannelStats::max() const {
+	return m_max;
+}
+
+/**************************************************************************/
+/*!
+	@brief  Gets the sliding window length
+*/
+/**************************************************************************/
+size_t adsChannelStats::window() const {
+	return m_ring.size();
+}
+
+/**************************************************************************/
+/*!
+	@brief  Gets the number of samples in the sliding window
+*/
+/**************************************************************************/
+size_t adsChannelStats::windowCount() const {
+	return m_count < m_ring.size() ? (size_t)m_count : m_ring.size();
+}
+
+/**************************************************************************/
+/*!
+	@brief  Gets the sliding window mean in codes
+*/
+/**************************************************************************/
+double adsChannelStats::windowMean() const {
+	size_t n = windowCount();
+	return n ? (double)m_sum / n : 0;
+}
+
+/**************************************************************************/
+/*!
+	@brief  Gets the sliding window RMS in codes
+*/
+/**************************************************************************/
+double adsChannelStats::windowRms() const {
+	size_t n = windowCount();
+	return n ? sqrt((double)m_sumSquares / n) : 0;
+}
+
+/**************************************************************************/
+/*!
+	@brief  Gets the sliding window population variance in codes^2
+*/
+/**************************************************************************/
+double adsChannelStats::windowVariance() const {
+	size_t n = windowCount();
+	if (!n)
+		return 0;
+
+	double variance = ((double)m_sumSquares - (double)m_sum * m_sum / n) / n;
+	return variance > 0 ? variance : 0;
+}
+
+/**************************************************************************/
+/*!
+	@brief  Gets the sliding window population standard deviation in codes
+*/
+/**************************************************************************/
+double adsChannelStats::windowStddev() const {
+	return sqrt(windowVariance());
+}
+
+/**************************************************************************/
+/*!
+	@brief  Gets the sliding window minimum, INT16_MAX if empty
+*/
+/**************************************************************************/
+int16_t adsChannelStats::windowMin() const {
+	if (!m_minDeque.size)
+		return INT16_MAX;
+
+	return m_ring[m_minDeque.positions[m_minDeque.head] % m_ring.size()];
+}
+
+/**************************************************************************/
+/*!
+	@brief  Gets the sliding window maximum, INT16_MIN if empty
+*/
+/**************************************************************************/
+int16_t adsChannelStats::windowMax() const {
+	if (!m_maxDeque.size)
+		return INT16_MIN;
+
+	return m_ring[m_maxDeque.positions[m_maxDeque.head] % m_ring.size()];
+}
+
+/**************************************************************************/
+/*!
+	@brief  Instantiates the statistics stage
+
+	@param channelCount number of channels, ADS_INPUT_COUNT when fed by
+			the driver directly (the channel is then the input)
+	@param window sliding window length in samples
+*/
+/**************************************************************************/
+adsStats::adsStats(size_t channelCount, size_t window)
+	: m_channels(channelCount, adsChannelStats(window))
+{
+}
+
+/**************************************************************************/
+/*!
+	@brief  Updates the statistics of the sample channel
+*/
+/**************************************************************************/
+void adsStats::onSample(const adsSample_t& sample) {
+	if (sample.channel < m_channels.size())
+		m_channels[sample.channel].add(sample.value);
+}
+
+/**************************************************************************/
+/*!
+	@brief  Resets the statistics of every channel
+*/
+/**************************************************************************/
+void adsStats::reset() {
+	for (size_t i = 0; i < m_channels.size(); i++)
+		m_channels[i].reset();
+}
+
+/**************************************************************************/
+/*!
+	@brief  Gets the number of channels
+*/
+/**************************************************************************/
+size_t adsStats::channelCount() const {
+	return m_channels.size();
+}
+
+/**************************************************************************/
+/*!
+	@brief  Gets the statistics of a channel, query them at any time
+*/
+/**************************************************************************/
+const adsChannelStats& adsStats::channel(uint8_t channel) const {
+	return m_channels[channel < m_channels.size() ? channel : 0];
+}
@@ -0,0 +1,105 @@
+/**************************************************************************/
+/*!
+    @file     ADS1X15_Stats.h
+
+    Incremental per-channel statistics computed at acquisition time.
+
+    Every sample updates, in O(1) and in raw code units:
+
+    - lifetime count/mean/variance (Welford) and min/max
+    - over a sliding window of the last N samples: exact integer sum and
+      sum of squares (mean, RMS, stddev) and monotonic deques (min, max)
+
+    Codes are only converted to floating point when a summary is queried,
+    so raw samples do not need to be stored by the application.
+
+    @section license License
+
+    BSD license, all text here must be included in any redistribution
+*/
+/**************************************************************************/
+
+#ifndef ADS1X15_STATS_H
+#define ADS1X15_STATS_H
+
+#include <vector>
+
+#include "ADS1X15_TLA2024.h"
+
+/*=========================================================================
+    STATISTICS SETTINGS
+    -----------------------------------------------------------------------*/
+#define ADS_STATS_DEFAULT_WINDOW (1024) ///< Sliding window length in samples
+/*=========================================================================*/
+
+/**************************************************************************/
+/*!
+    @brief  Lifetime and sliding-window statistics of one channel
+*/
+/**************************************************************************/
+class adsChannelStats {
+public:
+    adsChannelStats(size_t window = ADS_STATS_DEFAULT_WINDOW);
+    void   setWindow(size_t window);
+    void   reset(void);
+    void   add(int16_t code);
+
+    uint64_t count(void) const;
+    double   mean(void) const;
+    double   variance(void) const;
+    double   stddev(void) const;
+    int16_t  min(void) const;
+    int16_t  max(void) const;
+
+    size_t   window(void) const;
+    size_t   windowCount(void) const;
+    double   windowMean(void) const;
+    double   windowRms(void) const;
+    double   windowVariance(void) const;
+    double   windowStddev(void) const;
+    int16_t  windowMin(void) const;
+    int16_t  windowMax(void) const;
+
+private:
+    /** Fixed capacity deque of sample positions, values in m_ring */
+    typedef struct {
+        std::vector<uint64_t> positions;
+        size_t head;
+        size_t size;
+    } deque_t;
+
+    void dequePush(deque_t& deque, uint64_t position, bool keepMin);
+
+    // Lifetime (Welford)
+    uint64_t m_count;
+    double   m_mean;
+    double   m_m2;
+    int16_t  m_min;
+    int16_t  m_max;
+
+    // Sliding window
+    std::vector<int16_t> m_ring; ///< last window samples, indexed by position
+    int64_t  m_sum;
+    int64_t  m_sumSquares;
+    deque_t  m_minDeque;         ///< increasing values, front is the min
+    deque_t  m_maxDeque;         ///< decreasing values, front is the max
+};
+
+/**************************************************************************/
+/*!
+    @brief  Statistics stage keeping one adsChannelStats per channel
+*/
+/**************************************************************************/
+class adsStats : public adsSampleSink {
+public:
+    adsStats(size_t channelCount = ADS_INPUT_COUNT, size_t window = ADS_STATS_DEFAULT_WINDOW);
+    void onSample(const adsSample_t& sample);
+    void reset(void);
+    size_t channelCount(void) const;
+    const adsChannelStats& channel(uint8_t channel) const;
+
+private:
+    std::vector<adsChannelStats> m_channels;
+};
+
+#endif // ADS1X15_STATS_H
@@ -31,23 +31,26 @@
 /**************************************************************************/
 
 #include "ADS1X15_TLA2024.h"
+#include "ADS1X15_Iio.h"
 
 int i2cHandle;
 
 /**************************************************************************/
 /*!
 	@brief Init the i2c communication
+
+	@param tries attempts before giving up, FailTryCount or 1 to fail fast
 */
 /**************************************************************************/
-static int beginTransmission(const char* i2cDeviceName, uint8_t i2cAddress) {
+static int beginTransmission(const char* i2cDeviceName, uint8_t i2cAddress, size_t tries) {
 	// Create the file descriptor for the i2c bus
-	for (size_t i = 0; i < FailTryCount; i++)
+	for (size_t i = 0; i < tries; i++)
 	{
 		i2cHandle = open(i2cDeviceName, O_RDWR);
 		if (i2cHandle >= 0)
 			break;
 
-		if (i >= FailTryCount - 1)
+		if (i >= tries - 1)
 		{
 			fprintf(stderr, "Error while opening the i2c-0 device! Error: %s\n", strerror(errno));
 			return -1;
@@ -57,13 +60,14 @@ static int beginTransmission(const char* i2cDeviceName, uint8_t i2cAddress) {
 	}
 
 	// Set the slave address
-	for (size_t i = 0; i < FailTryCount; i++)
+	for (size_t i = 0; i < tries; i++)
 	{
 		if (ioctl(i2cHandle, I2C_SLAVE, i2cAddress) >= 0)
 			break;
 
-		if (i >= FailTryCount - 1)
+		if (i >= tries - 1)
 		{
+			close(i2cHandle);
 			fprintf(stderr, "Error while configuring the slave address %d. Error: %s\n", i2cAddress, strerror(errno));
 			return -1;
 		}
@@ -91,11 +95,17 @@ static void endTransmission(void) {
 	@param i2cAddress I2C address of device
 	@param reg register address to write to
 	@param value value to write to register
+	@param pointer cached pointer register of the device, updated to reg
+	@param tries attempts to open the bus
+
+	@return 1 on success, -1 on error
 */
 /**************************************************************************/
-static void writeRegister(const char* i2cDeviceName, uint8_t i2cAddress, uint8_t reg, uint16_t value) {
-	if (beginTransmission(i2cDeviceName, i2cAddress) < 0)
-		return;
+static int writeRegister(const char* i2cDeviceName, uint8_t i2cAddress, uint8_t reg, uint16_t value, uint8_t* pointer, size_t tries) {
+	if (beginTransmission(i2cDeviceName, i2cAddress, tries) < 0) {
+		*pointer = ADS1015_REG_POINTER_UNKNOWN;
+		return -1;
+	}
 
 	int rc;
 	unsigned char buf[3] = { reg, (uint8_t)(value >> 8) , (uint8_t)(value & 0xFF) };
@@ -107,35 +117,57 @@ static void writeRegister(const char* i2cDeviceName, uint8_t i2cAddress, uint8_t
 			printf("Differential:");
 
 		printf("Write Error\n");
-	};
+		*pointer = ADS1015_REG_POINTER_UNKNOWN;
+	}
+	else {
+		// The device keeps the pointer register until it is written again
+		*pointer = reg;
+	}
 	endTransmission();
+	return rc == 3 ? 1 : -1;
 }
 
 /**************************************************************************/
 /*!
-	@brief  Read 16-bits from the specified destination register
+	@brief  Read 16-bits from the specified destination register.
+			The pointer byte is only written when the device is not
+			already pointing at reg, otherwise a bare 2-byte read is issued.
 
 	@param i2cDeviceName I2C device name
 	@param i2cAddress I2C address of device
 	@param reg register address to read from
+	@param value 16 bit register value read, 0 on error
+	@param pointer cached pointer register of the device, updated to reg
+	@param tries attempts to open the bus
 
-	@return 16 bit register value read
+	@return 1 on success, -1 on error
 */
 /**************************************************************************/
-static uint16_t readRegister(const char* i2cDeviceName, uint8_t i2cAddress, uint8_t reg) {
-	if (beginTransmission(i2cDeviceName, i2cAddress) < 0)
-		return NULL;
+static int readRegister(const char* i2cDeviceName, uint8_t i2cAddress, uint8_t reg, uint16_t* value, uint8_t* pointer, size_t tries) {
+	*value = 0;
+	if (beginTransmission(i2cDeviceName, i2cAddress, tries) < 0) {
+		*pointer = ADS1015_REG_POINTER_UNKNOWN;
+		return -1;
+	}
 
 	int rc;
-	unsigned char buf[1] = { reg };
-	rc = write(i2cHandle, buf, 1);
-	if (rc == -1) {
-		if (i2cAddress == I2CADDRESS_1)
-			printf("SingleEnded:");
-		else
-			printf("Differential:");
-
-		printf("Write Error\n");
+	bool failed = false;
+	if (*pointer != reg) {
+		unsigned char buf[1] = { reg };
+		rc = write(i2cHandle, buf, 1);
+		if (rc == -1) {
+			if (i2cAddress == I2CADDRESS_1)
+				printf("SingleEnded:");
+			else
+				printf("Differential:");
+
+			printf("Write Error\n");
+			*pointer = ADS1015_REG_POINTER_UNKNOWN;
+			failed = true;
+		}
+		else {
+			*pointer = reg;
+		}
 	}
 
 	unsigned char readbuf[2] = {  };
@@ -147,11 +179,13 @@ static uint16_t readRegister(const char* i2cDeviceName, uint8_t i2cAddress, uint
 			printf("Differential:");
 
 		printf("Read Error\n");
+		*pointer = ADS1015_REG_POINTER_UNKNOWN;
+		failed = true;
 	}
 
 	endTransmission();
-	uint16_t registerValue = ((readbuf[0] << 8) | readbuf[1]);
-	return registerValue;
+	*value = ((readbuf[0] << 8) | readbuf[1]);
+	return failed || rc != 2 ? -1 : 1;
 }
 
 /**************************************************************************/
@@ -171,6 +205,18 @@ TLA2024::TLA2024(const char* i2cDeviceName, uint8_t i2cAddress)
 	m_bitShift = 4;
 	m_gain = GAIN_TWOTHIRDS; /* +/- 6.144V range (limited to VDD +0.3V max!) */
 	m_sps = SPS_1600;
+	m_pointer = ADS1015_REG_POINTER_UNKNOWN;
+	m_continuous = false;
+	m_lastInput = ADS_INPUT_DIFF_0_1;
+	m_sink = NULL;
+	m_iio = NULL;
+	m_continuousConfig = 0;
+	m_thresholdRegister = 0;
+	m_recovery = false;
+	m_failures = 0;
+	m_available = true;
+	m_restorePending = false;
+	m_freshNs = 0;
 	setConversionDelay();
 }
 
@@ -191,6 +237,18 @@ ADS1015::ADS1015(const char* i2cDeviceName, uint8_t i2cAddress)
 	m_bitShift = 4;
 	m_gain = GAIN_TWOTHIRDS; /* +/- 6.144V range (limited to VDD +0.3V max!) */
 	m_sps = SPS_1600;
+	m_pointer = ADS1015_REG_POINTER_UNKNOWN;
+	m_continuous = false;
+	m_lastInput = ADS_INPUT_DIFF_0_1;
+	m_sink = NULL;
+	m_iio = NULL;
+	m_continuousConfig = 0;
+	m_thresholdRegister = 0;
+	m_recovery = false;
+	m_failures = 0;
+	m_available = true;
+	m_restorePending = false;
+	m_freshNs = 0;
 	setConversionDelay();
 }
 
@@ -211,6 +269,18 @@ ADS1115::ADS1115(const char* i2cDeviceName, uint8_t i2cAddress)
 	m_bitShift = 0;
 	m_gain = GAIN_TWOTHIRDS; /* +/- 6.144V range (limited to VDD +0.3V max!) */
 	m_sps = SPS_1600;
+	m_pointer = ADS1015_REG_POINTER_UNKNOWN;
+	m_continuous = false;
+	m_lastInput = ADS_INPUT_DIFF_0_1;
+	m_sink = NULL;
+	m_iio = NULL;
+	m_continuousConfig = 0;
+	m_thresholdRegister = 0;
+	m_recovery = false;
+	m_failures = 0;
+	m_available = true;
+	m_restorePending = false;
+	m_freshNs = 0;
 	setConversionDelay();
 }
 
@@ -223,6 +293,12 @@ ADS1115::ADS1115(const char* i2cDeviceName, uint8_t i2cAddress)
 /**************************************************************************/
 void TLA2024::updateI2cDevice(const char* i2cDeviceName) {
 	m_i2cDeviceName = i2cDeviceName;
+	m_pointer = ADS1015_REG_POINTER_UNKNOWN;
+	m_failures = 0;
+
+	// The new bus gets the cached configuration on the next transaction
+	m_restorePending = true;
+	m_available = true;
 }
 
 /**************************************************************************/
@@ -278,6 +354,14 @@ uint16_t TLA2024::readADC_SingleEnded(uint8_t channel) {
 		return 0;
 	}
 
+	if (m_iio) {
+		return (uint16_t)readADC_Input(ADS_INPUT_SINGLE(channel));
+	}
+
+	if (!isAvailable()) {
+		return 0;
+	}
+
 	// Start with default values
 	uint16_t config =
 		ADS1015_REG_CONFIG_CQUE_NONE |    // Disable the comparator (default val)
@@ -311,18 +395,22 @@ uint16_t TLA2024::readADC_SingleEnded(uint8_t channel) {
 	// Set 'start single-conversion' bit
 	config |= ADS1015_REG_CONFIG_OS_SINGLE;
 
-	// Write config register to the ADC
-	writeRegister(m_i2cDeviceName, m_i2cAddress, ADS1015_REG_POINTER_CONFIG, config);
+	// Write config register to the ADC, a restore on the way sees the new input
+	m_continuous = false;
+	m_lastInput = ADS_INPUT_SINGLE(channel);
+	writeDeviceRegister(ADS1015_REG_POINTER_CONFIG, config);
 
 	// Wait for the conversion to complete
 	usleep(m_conversionDelay);
 	do {
 		usleep(10);
-	} while (ADS1015_REG_CONFIG_OS_BUSY == (readRegister(m_i2cDeviceName, m_i2cAddress, ADS1015_REG_POINTER_CONFIG) & ADS1015_REG_CONFIG_OS_MASK));
+	} while (!isConversionReady());
 
 	// Read the conversion results
 	// Shift 12-bit results right 4 bits for the ADS1015
-	return readRegister(m_i2cDeviceName, m_i2cAddress, ADS1015_REG_POINTER_CONVERT) >> m_bitShift;
+	uint16_t res = readDeviceRegister(ADS1015_REG_POINTER_CONVERT) >> m_bitShift;
+	publishSample(m_lastInput, (int16_t)res);
+	return res;
 }
 
 /**************************************************************************/
@@ -336,6 +424,117 @@ uint16_t TLA2024::readADC_SingleEnded(uint8_t channel) {
 */
 /**************************************************************************/
 int16_t TLA2024::readADC_Differential_0_1() {
+	return readADC_Input(ADS_INPUT_DIFF_0_1);
+}
+
+/**************************************************************************/
+/*!
+	@brief  Reads the conversion results, measuring the voltage
+			difference between the P (AIN2) and N (AIN3) input.  Generates
+			a signed value since the difference can be either
+			positive or negative.
+
+	@return the ADC reading
+*/
+/**************************************************************************/
+int16_t TLA2024::readADC_Differential_2_3() {
+	return readADC_Input(ADS_INPUT_DIFF_2_3);
+}
+
+/**************************************************************************/
+/*!
+	@brief  Reads the conversion results of any of the 8 multiplexer
+			settings.  Generates a signed value since differential
+			inputs can be either positive or negative.
+
+	@param input ADS_INPUT_* multiplexer setting
+
+	@return the ADC reading, 0 on error (see readADC_Input(uint8_t, int16_t*))
+*/
+/**************************************************************************/
+int16_t TLA2024::readADC_Input(uint8_t input) {
+	int16_t value;
+	readADC_Input(input, &value);
+	return value;
+}
+
+/**************************************************************************/
+/*!
+	@brief  Reads the conversion results of any of the 8 multiplexer
+			settings, telling a failed read from a real 0.  Fails at once
+			while the device is unavailable.
+
+	@param input ADS_INPUT_* multiplexer setting
+	@param value ADC reading, 0 on error
+
+	@return 1 on success, -1 on error
+*/
+/**************************************************************************/
+int TLA2024::readADC_Input(uint8_t input, int16_t* value) {
+	*value = 0;
+	if (input >= ADS_INPUT_COUNT) {
+		return -1;
+	}
+
+	if (!m_iio && !isAvailable()) {
+		return -1;
+	}
+
+	if (startInput(input) < 0) {
+		return -1;
+	}
+
+	// The kernel driver waits for the conversion
+	if (!m_iio) {
+		usleep(m_conversionDelay);
+		do {
+			usleep(10);
+		} while (!isConversionReady());
+	}
+
+	if (readConversionResult(value) < 0) {
+		return -1;
+	}
+
+	publishSample(input, *value);
+	return 1;
+}
+
+/**************************************************************************/
+/*!
+	@brief  Starts a single-shot conversion of any of the 8 multiplexer
+			settings and returns immediately.  Use isConversionReady()
+			and readConversionResult() to collect the result.
+
+	@param input ADS_INPUT_* multiplexer setting
+*/
+/**************************************************************************/
+void TLA2024::startADC_Input(uint8_t input) {
+	startInput(input);
+}
+
+/**************************************************************************/
+/*!
+	@brief  Writes the single-shot config of an input, starting the
+			conversion
+
+	@param input ADS_INPUT_* multiplexer setting
+
+	@return 1 on success, -1 on error
+*/
+/**************************************************************************/
+int TLA2024::startInput(uint8_t input) {
+	if (input >= ADS_INPUT_COUNT) {
+		return -1;
+	}
+
+	if (m_iio) {
+		// Converted by the raw attribute read in readConversionResult()
+		m_continuous = false;
+		m_lastInput = input;
+		return 1;
+	}
+
 	// Start with default values
 	uint16_t config =
 		ADS1015_REG_CONFIG_CQUE_NONE |    // Disable the comparator (default val)
@@ -351,82 +550,125 @@ int16_t TLA2024::readADC_Differential_0_1() {
 	config |= m_sps;
 
 	// Set channels
-	config |= ADS1015_REG_CONFIG_MUX_DIFF_0_1; // AIN0 = P, AIN1 = N
+	config |= ADS_INPUT_TO_MUX(input);
 
 	// Set 'start single-conversion' bit
 	config |= ADS1015_REG_CONFIG_OS_SINGLE;
 
 	// Write config register to the ADC
-	writeRegister(m_i2cDeviceName, m_i2cAddress, ADS1015_REG_POINTER_CONFIG, config);
-
-	// Wait for the conversion to complete
-	usleep(m_conversionDelay);
-	do {
-		usleep(10);
-	} while (ADS1015_REG_CONFIG_OS_BUSY == (readRegister(m_i2cDeviceName, m_i2cAddress, ADS1015_REG_POINTER_CONFIG) & ADS1015_REG_CONFIG_OS_MASK));
-
-	// Read the conversion results
-	uint16_t res = readRegister(m_i2cDeviceName, m_i2cAddress, ADS1015_REG_POINTER_CONVERT) >> m_bitShift;
-
-	if (m_bitShift == 0) {
-		return (int16_t)res;
-	}
-	else {
-		// Shift 12-bit results right 4 bits for the ADS1015,
-		// making sure we keep the sign bit intact
-		if (res > 0x07FF) {
-			// negative number - extend the sign to 16th bit
-			res |= 0xF000;
-		}
-		return (int16_t)res;
-	}
+	m_continuous = false;
+	m_lastInput = input;
+	return writeDeviceRegister(ADS1015_REG_POINTER_CONFIG, config);
 }
 
 /**************************************************************************/
 /*!
-	@brief  Reads the conversion results, measuring the voltage
-			difference between the P (AIN2) and N (AIN3) input.  Generates
-			a signed value since the difference can be either
-			positive or negative.
+	@brief  Starts continuous conversions of one input.  The conversion
+			register then always holds the latest result: read it with
+			readConversionResult(), repeated reads are bare 2-byte reads.
+			The next single-shot conversion stops it.
 
-	@return the ADC reading
+	@param input ADS_INPUT_* multiplexer setting
 */
 /**************************************************************************/
-int16_t TLA2024::readADC_Differential_2_3() {
-	// Start with default values
+void TLA2024::startADC_Continuous(uint8_t input) {
+	if (input >= ADS_INPUT_COUNT) {
+		return;
+	}
+
+	if (m_iio) {
+		fprintf(stderr, "Error while starting continuous conversions! They are not available through IIO\n");
+		return;
+	}
+
 	uint16_t config =
 		ADS1015_REG_CONFIG_CQUE_NONE |    // Disable the comparator (default val)
 		ADS1015_REG_CONFIG_CLAT_NONLAT |  // Non-latching (default val)
 		ADS1015_REG_CONFIG_CPOL_ACTVLOW | // Alert/Rdy active low   (default val)
 		ADS1015_REG_CONFIG_CMODE_TRAD |   // Traditional comparator (default val)
-		ADS1015_REG_CONFIG_MODE_SINGLE;   // Single-shot mode (default)
+		ADS1015_REG_CONFIG_MODE_CONTIN;   // Continuous conversion mode
 
-	// Set PGA/voltage range
 	config |= m_gain;
-
-	// Set the sample rate
 	config |= m_sps;
+	config |= ADS_INPUT_TO_MUX(input);
 
-	// Set channels
-	config |= ADS1015_REG_CONFIG_MUX_DIFF_2_3; // AIN2 = P, AIN3 = N
+	// Write config register to the ADC
+	m_continuousConfig = config;
+	m_continuous = true;
+	m_lastInput = input;
+	writeDeviceRegister(ADS1015_REG_POINTER_CONFIG, config);
+}
 
-	// Set 'start single-conversion' bit
-	config |= ADS1015_REG_CONFIG_OS_SINGLE;
+/**************************************************************************/
+/*!
+	@brief  Checks the OS bit of the config register.  Repeated calls
+			are bare 2-byte reads, the pointer stays on the config register.
 
-	// Write config register to the ADC
-	writeRegister(m_i2cDeviceName, m_i2cAddress, ADS1015_REG_POINTER_CONFIG, config);
+	@return true when no single-shot conversion is in progress, or when
+			the config register cannot be read (there is nothing to wait for)
+*/
+/**************************************************************************/
+bool TLA2024::isConversionReady() {
+	if (m_iio) {
+		return true;
+	}
 
-	// Wait for the conversion to complete
-	usleep(m_conversionDelay);
-	do {
-		usleep(10);           
-	} while (ADS1015_REG_CONFIG_OS_BUSY == (readRegister(m_i2cDeviceName, m_i2cAddress, ADS1015_REG_POINTER_CONFIG) & ADS1015_REG_CONFIG_OS_MASK));
+	uint16_t config;
+	if (readDeviceRegister(ADS1015_REG_POINTER_CONFIG, &config) < 0) {
+		return true;
+	}
+
+	return ADS1015_REG_CONFIG_OS_BUSY != (config & ADS1015_REG_CONFIG_OS_MASK);
+}
+
+/**************************************************************************/
+/*!
+	@brief  Reads the conversion register without waiting.  Generates a
+			signed value, the 12-bit results are sign extended.
+
+	@return the ADC reading, 0 on error (see readConversionResult(int16_t*))
+*/
+/**************************************************************************/
+int16_t TLA2024::readConversionResult() {
+	int16_t value;
+	readConversionResult(&value);
+	return value;
+}
+
+/**************************************************************************/
+/*!
+	@brief  Reads the conversion register without waiting, telling a
+			failed read from a real 0.  Right after a reconnect in
+			continuous mode the register still holds a result from before
+			the restore: the read fails until the first new conversion.
+
+	@param value ADC reading, 0 on error
+
+	@return 1 on success, -1 on error
+*/
+/**************************************************************************/
+int TLA2024::readConversionResult(int16_t* value) {
+	*value = 0;
+	if (m_iio) {
+		if (m_iio->configure(m_lastInput, m_adsType, m_gain, m_sps) < 0)
+			return -1;
+		return m_iio->readRaw(m_lastInput, value);
+	}
 
 	// Read the conversion results
-	uint16_t res =
-		readRegister(m_i2cDeviceName, m_i2cAddress, ADS1015_REG_POINTER_CONVERT) >> m_bitShift;
+	uint16_t res;
+	if (readDeviceRegister(ADS1015_REG_POINTER_CONVERT, &res) < 0)
+		return -1;
+
+	if (m_freshNs) {
+		if (adsTimestampNs() < m_freshNs)
+			return -1;
+		m_freshNs = 0;
+	}
+
+	res >>= m_bitShift;
 	if (m_bitShift == 0) {
-		return (int16_t)res;
+		*value = (int16_t)res;
 	}
 	else {
 		// Shift 12-bit results right 4 bits for the ADS1015,
@@ -435,8 +677,42 @@ int16_t TLA2024::readADC_Differential_2_3() {
 			// negative number - extend the sign to 16th bit
 			res |= 0xF000;
 		}
-		return (int16_t)res;
+		*value = (int16_t)res;
 	}
+	return 1;
+}
+
+/**************************************************************************/
+/*!
+	@brief  Gets the time a conversion takes at the current sample rate
+
+	@return the conversion delay in uS
+*/
+/**************************************************************************/
+uint32_t TLA2024::getConversionDelay() {
+	return m_conversionDelay;
+}
+
+/**************************************************************************/
+/*!
+	@brief  Gets the chip type
+
+	@return tla2024, ads1015 or ads1115
+*/
+/**************************************************************************/
+uint8_t TLA2024::getAdsType() {
+	return m_adsType;
+}
+
+/**************************************************************************/
+/*!
+	@brief  Checks if the device was left in continuous conversion mode
+
+	@return true after startComparator_SingleEnded()
+*/
+/**************************************************************************/
+bool TLA2024::isContinuous() {
+	return m_continuous;
 }
 
 /**************************************************************************/
@@ -453,6 +729,11 @@ int16_t TLA2024::readADC_Differential_2_3() {
 /**************************************************************************/
 void ADS1015::startComparator_SingleEnded(uint8_t channel,
 	int16_t threshold) {
+	if (m_iio) {
+		fprintf(stderr, "Error while starting the comparator! It is not available through IIO\n");
+		return;
+	}
+
 	// Start with default values
 	uint16_t config =
 		ADS1015_REG_CONFIG_CQUE_1CONV |   // Comparator enabled and asserts on 1
@@ -485,13 +766,18 @@ void ADS1015::startComparator_SingleEnded(uint8_t channel,
 		break;
 	}
 
-	// Set the high threshold register
+	// Cache the new setup first, a restore on the way writes it
 	// Shift 12-bit results left 4 bits for the ADS1015
-	writeRegister(m_i2cDeviceName, m_i2cAddress, ADS1015_REG_POINTER_HITHRESH,
-		threshold << m_bitShift);
+	m_thresholdRegister = threshold << m_bitShift;
+	m_continuousConfig = config;
+	m_continuous = true;
+	m_lastInput = ADS_INPUT_SINGLE(channel & 3);
+
+	// Set the high threshold register
+	writeDeviceRegister(ADS1015_REG_POINTER_HITHRESH, m_thresholdRegister);
 
 	// Write config register to the ADC
-	writeRegister(m_i2cDeviceName, m_i2cAddress, ADS1015_REG_POINTER_CONFIG, config);
+	writeDeviceRegister(ADS1015_REG_POINTER_CONFIG, config);
 }
 
 /**************************************************************************/
@@ -500,31 +786,259 @@ void ADS1015::startComparator_SingleEnded(uint8_t channel,
 			conversion results.  This function reads the last conversion
 			results without changing the config value.
 
+			In continuous mode the conversion register always holds the
+			latest result, so the OS bit is not polled and repeated calls
+			leave the pointer on the conversion register.
+
 	@return the last ADC reading
 */
 /**************************************************************************/
 int16_t TLA2024::getLastConversionResults() {
+	if (m_iio) {
+		return readADC_Input(m_lastInput);
+	}
+
+	if (!isAvailable()) {
+		return 0;
+	}
+
 	// Wait for the conversion to complete
 	usleep(m_conversionDelay);
-	do {
-		usleep(10);
-	} while (ADS1015_REG_CONFIG_OS_BUSY == (readRegister(m_i2cDeviceName, m_i2cAddress, ADS1015_REG_POINTER_CONFIG) & ADS1015_REG_CONFIG_OS_MASK));
+	if (!m_continuous) {
+		do {
+			usleep(10);
+		} while (!isConversionReady());
+	}
 
-	// Read the conversion results
-	uint16_t res =
-		readRegister(m_i2cDeviceName, m_i2cAddress, ADS1015_REG_POINTER_CONVERT) >> m_bitShift;
-	if (m_bitShift == 0) {
-		return (int16_t)res;
+	int16_t res;
+	if (readConversionResult(&res) < 0 && m_freshNs) {
+		// Reconnected meanwhile, wait for the first conversion of the restored config
+		usleep(m_conversionDelay);
+		readConversionResult(&res);
 	}
-	else {
-		// Shift 12-bit results right 4 bits for the ADS1015,
-		// making sure we keep the sign bit intact
-		if (res > 0x07FF) {
-			// negative number - extend the sign to 16th bit
-			res |= 0xF000;
-		}
-		return (int16_t)res;
+	publishSample(m_lastInput, res);
+	return res;
+}
+
+/**************************************************************************/
+/*!
+	@brief  Reads a register of the device, tracking the failures when
+			recovery is enabled.  Fails fast while the device is unavailable.
+
+	@param reg register address to read from
+	@param value 16 bit register value read, 0 on error
+
+	@return 1 on success, -1 on error
+*/
+/**************************************************************************/
+int TLA2024::readDeviceRegister(uint8_t reg, uint16_t* value) {
+	*value = 0;
+	if (!isAvailable())
+		return -1;
+
+	if (m_restorePending.exchange(false))
+		restoreConfig(true);
+
+	int rc = readRegister(m_i2cDeviceName, m_i2cAddress, reg, value, &m_pointer, m_recovery ? 1 : FailTryCount);
+	transferDone(rc > 0);
+	return rc;
+}
+
+/**************************************************************************/
+/*!
+	@brief  Reads a register of the device, 0 on error
+*/
+/**************************************************************************/
+uint16_t TLA2024::readDeviceRegister(uint8_t reg) {
+	uint16_t value;
+	readDeviceRegister(reg, &value);
+	return value;
+}
+
+/**************************************************************************/
+/*!
+	@brief  Writes a register of the device, tracking the failures when
+			recovery is enabled.  Dropped while the device is unavailable.
+
+	@param reg register address to write to
+	@param value value to write to register
+
+	@return 1 on success, -1 on error
+*/
+/**************************************************************************/
+int TLA2024::writeDeviceRegister(uint8_t reg, uint16_t value) {
+	if (!isAvailable())
+		return -1;
+
+	// A config write starts its own conversion, which a restart would block
+	if (m_restorePending.exchange(false))
+		restoreConfig(reg != ADS1015_REG_POINTER_CONFIG);
+
+	int rc = writeRegister(m_i2cDeviceName, m_i2cAddress, reg, value, &m_pointer, m_recovery ? 1 : FailTryCount);
+	transferDone(rc > 0);
+	return rc;
+}
+
+/**************************************************************************/
+/*!
+	@brief  Counts the consecutive failed transactions and marks the
+			device unavailable after ADS_RECOVERY_FAIL_COUNT of them
+
+	@param ok true if the transaction succeeded
+*/
+/**************************************************************************/
+void TLA2024::transferDone(bool ok) {
+	if (ok) {
+		m_failures = 0;
+		return;
 	}
+
+	if (!m_recovery || ++m_failures < ADS_RECOVERY_FAIL_COUNT)
+		return;
+
+	fprintf(stderr, "Error while talking to the device 0x%02X on %s! Recovering in the background\n", m_i2cAddress, m_i2cDeviceName);
+	m_available = false;
+}
+
+/**************************************************************************/
+/*!
+	@brief  Writes the cached configuration back after a reconnect: the
+			threshold and continuous mode of the comparator.  The
+			conversion register still holds a result from before, so in
+			single-shot mode the last input is converted again (the OS bit
+			then holds the next read back) and in continuous mode the
+			results are stale until one conversion delay has elapsed.
+
+	@param restart false when the pending operation writes the config
+			register: the chip would ignore its OS bit during a restart
+*/
+/**************************************************************************/
+void TLA2024::restoreConfig(bool restart) {
+	m_pointer = ADS1015_REG_POINTER_UNKNOWN;
+	if (!m_continuous) {
+		if (restart)
+			startInput(m_lastInput);
+		return;
+	}
+
+	writeDeviceRegister(ADS1015_REG_POINTER_HITHRESH, m_thresholdRegister);
+	writeDeviceRegister(ADS1015_REG_POINTER_CONFIG, m_continuousConfig);
+	m_freshNs = adsTimestampNs() + (uint64_t)m_conversionDelay * 1000;
+}
+
+/**************************************************************************/
+/*!
+	@brief  Enables the failure tracking used by adsRecovery: after
+			ADS_RECOVERY_FAIL_COUNT failed transactions the device is
+			unavailable and every call returns at once (reads give 0, the
+			status reads -1) until the monitor sees it again.  Bus opens
+			are not retried.
+
+	@param enabled true to enable
+*/
+/**************************************************************************/
+void TLA2024::setRecovery(bool enabled) {
+	m_recovery = enabled;
+	m_failures = 0;
+	m_available = true;
+}
+
+/**************************************************************************/
+/*!
+	@brief  Checks if the device answers, always true without recovery
+*/
+/**************************************************************************/
+bool TLA2024::isAvailable() {
+	return !m_recovery || m_available;
+}
+
+/**************************************************************************/
+/*!
+	@brief  Marks the device back, called by the recovery monitor once it
+			answers again.  The cached configuration is restored by the
+			next transaction, on the caller's thread.
+*/
+/**************************************************************************/
+void TLA2024::markReconnected() {
+	m_failures = 0;
+	m_restorePending = true;
+	m_available = true;
+}
+
+/**************************************************************************/
+/*!
+	@brief  Gets the I2C device name
+*/
+/**************************************************************************/
+const char* TLA2024::getI2cDeviceName() {
+	return m_i2cDeviceName;
+}
+
+/**************************************************************************/
+/*!
+	@brief  Gets the I2C address
+*/
+/**************************************************************************/
+uint8_t TLA2024::getI2cAddress() {
+	return m_i2cAddress;
+}
+
+/**************************************************************************/
+/*!
+	@brief  Sets the stage fed with the results of the blocking reads
+			(readADC_*, getLastConversionResults()).  The split-phase
+			reads are published by their own acquisition path.
+
+	@param sink stage to feed, NULL to disable
+*/
+/**************************************************************************/
+void TLA2024::setSampleSink(adsSampleSink* sink) {
+	m_sink = sink;
+}
+
+/**************************************************************************/
+/*!
+	@brief  Routes the conversions through the Linux IIO driver instead of
+			i2c-dev.  The split-phase reads then block in
+			readConversionResult() and the comparator is not available.
+
+	@param iio opened IIO transport, must outlive the device; NULL to go
+			back to i2c-dev
+*/
+/**************************************************************************/
+void TLA2024::setIio(adsIio* iio) {
+	m_iio = iio;
+	m_pointer = ADS1015_REG_POINTER_UNKNOWN;
+}
+
+/**************************************************************************/
+/*!
+	@brief  Gets the IIO transport, NULL when using i2c-dev
+*/
+/**************************************************************************/
+adsIio* TLA2024::getIio() {
+	return m_iio;
+}
+
+/**************************************************************************/
+/*!
+	@brief  Feeds a result to the sample sink, if any
+
+	@param input ADS_INPUT_* multiplexer setting
+	@param value ADC code
+*/
+/**************************************************************************/
+void TLA2024::publishSample(uint8_t input, int16_t value) {
+	if (!m_sink)
+		return;
+
+	adsSample_t sample;
+	sample.timestampNs = adsTimestampNs();
+	sample.value = value;
+	sample.channel = input;
+	sample.input = input;
+	sample.alert = 0;
+	m_sink->onSample(sample);
 }
 
 /**************************************************************************/
@@ -601,4 +1115,18 @@ void TLA2024::setConversionDelay()
 		}
 	}
 	m_conversionDelay += 100; // Add 100 us to be safe
-}
\ No newline at end of file
+}
+
+/**************************************************************************/
+/*!
+	@brief  Monotonic timestamp used to stamp samples, shared by all
+			processes on the machine
+
+	@return CLOCK_MONOTONIC time in nanoseconds
+*/
+/**************************************************************************/
+uint64_t adsTimestampNs(void) {
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
@@ -30,6 +30,10 @@
 */
 /**************************************************************************/
 
+#ifndef ADS1X15_TLA2024_H
+#define ADS1X15_TLA2024_H
+
+#include <atomic>
 #include <errno.h>
 #include <stdint.h>
 #include <stdio.h>
@@ -38,6 +42,7 @@
 #include <fcntl.h>
 #include <linux/i2c-dev.h>
 #include <sys/ioctl.h>
+#include <time.h>
 #include <unistd.h>
 
 /*=========================================================================
@@ -45,6 +50,7 @@
     -----------------------------------------------------------------------*/
 #define I2CDeviceDefaultName "/dev/i2c-0"
 #define FailTryCount 10
+#define ADS_RECOVERY_FAIL_COUNT (3) ///< Failed transactions before a device is unavailable (recovery enabled)
     //#define DEBUG
             /*=========================================================================*/
 
@@ -54,6 +60,7 @@
 #define I2CADDRESS_1                 (0x48)    // 1001 000 (ADDR = GND)
 #define I2CADDRESS_2                 (0x49)    // 1001 000 (ADDR = VDD)
 #define I2CADDRESS_3                 (0x4B)    // 1001 000 (ADDR = SCL)
+#define I2CADDRESS_4                 (0x4A)    // 1001 010 (ADDR = SDA)
                 /*=========================================================================*/
 
                 /*=========================================================================
@@ -80,6 +87,7 @@
 #define ADS1015_REG_POINTER_CONFIG (0x01)    ///< Configuration
 #define ADS1015_REG_POINTER_LOWTHRESH (0x02) ///< Low threshold
 #define ADS1015_REG_POINTER_HITHRESH (0x03)  ///< High threshold
+#define ADS1015_REG_POINTER_UNKNOWN (0xFF)   ///< Device pointer not known (cache only)
                     /*=========================================================================*/
 
                     /*=========================================================================
@@ -162,6 +170,23 @@
 #define TLA2024_REG_RESERVED (0x0003)  ///< Reserved section must be written 03h
                         /*=========================================================================*/
 
+/*=========================================================================
+    INPUTS (MUX setting, config bits 14:12)
+    -----------------------------------------------------------------------*/
+#define ADS_INPUT_DIFF_0_1 (0) ///< Differential P = AIN0, N = AIN1
+#define ADS_INPUT_DIFF_0_3 (1) ///< Differential P = AIN0, N = AIN3
+#define ADS_INPUT_DIFF_1_3 (2) ///< Differential P = AIN1, N = AIN3
+#define ADS_INPUT_DIFF_2_3 (3) ///< Differential P = AIN2, N = AIN3
+#define ADS_INPUT_SINGLE_0 (4) ///< Single-ended AIN0
+#define ADS_INPUT_SINGLE_1 (5) ///< Single-ended AIN1
+#define ADS_INPUT_SINGLE_2 (6) ///< Single-ended AIN2
+#define ADS_INPUT_SINGLE_3 (7) ///< Single-ended AIN3
+#define ADS_INPUT_COUNT    (8) ///< Number of multiplexer settings
+
+#define ADS_INPUT_SINGLE(channel) ((uint8_t)(ADS_INPUT_SINGLE_0 + (channel))) ///< Single-ended input of a channel
+#define ADS_INPUT_TO_MUX(input) ((uint16_t)((input) << 12)) ///< Config MUX bits of an input
+/*=========================================================================*/
+
                         /** Gain settings */
 typedef enum {
     GAIN_TWOTHIRDS = ADS1015_REG_CONFIG_PGA_6_144V,
@@ -185,6 +210,28 @@ typedef enum
     SPS_860 = ADS1115_REG_CONFIG_DR_860SPS
 } adsSps_t;
 
+/** One conversion result */
+typedef struct {
+    uint64_t timestampNs; ///< CLOCK_MONOTONIC time the result was read
+    int16_t  value;       ///< ADC code, sign extended
+    uint8_t  channel;     ///< channel index in the acquisition group, the input for direct reads
+    uint8_t  input;       ///< ADS_INPUT_* multiplexer setting
+    uint8_t  alert;       ///< comparator channels: value reached the threshold
+} adsSample_t;
+
+/**************************************************************************/
+/*!
+    @brief  Processing stage fed with every sample of the acquisition path
+*/
+/**************************************************************************/
+class adsSampleSink {
+public:
+    virtual ~adsSampleSink() {}
+    virtual void onSample(const adsSample_t& sample) = 0; ///< Called for every conversion
+};
+
+class adsIio;
+
 /**************************************************************************/
 /*!
     @brief  Sensor driver for the TLA2024 ADC breakout.
@@ -195,17 +242,45 @@ protected:
     // Instance-specific properties
     const char* m_i2cDeviceName;
     uint8_t m_i2cAddress;      ///< the I2C address
-    uint8_t m_conversionDelay; ///< conversion deay
+    uint32_t m_conversionDelay; ///< conversion deay in uS
     uint8_t m_bitShift;        ///< bit shift amount
     adsGain_t m_gain;          ///< ADC gain
     adsSps_t  m_sps;
     uint8_t   m_adsType;
+    uint8_t   m_pointer;           ///< last pointer register written to the device
+    bool      m_continuous;        ///< device left in continuous conversion mode
+    uint8_t   m_lastInput;         ///< input of the last conversion started
+    adsSampleSink* m_sink;         ///< stage fed with the readADC_* results
+    adsIio*   m_iio;               ///< kernel driver transport, NULL for i2c-dev
+    uint16_t  m_continuousConfig;  ///< config of startComparator_SingleEnded(), restored after a reconnect
+    uint16_t  m_thresholdRegister; ///< high threshold of startComparator_SingleEnded(), restored after a reconnect
+    bool      m_recovery;          ///< failure tracking and fast failures enabled
+    std::atomic<uint8_t> m_failures;   ///< consecutive failed transactions, reset by the recovery thread
+    std::atomic<bool> m_available;      ///< cleared after ADS_RECOVERY_FAIL_COUNT failures
+    std::atomic<bool> m_restorePending; ///< reconnected, restore the configuration first
+    uint64_t  m_freshNs;           ///< continuous results before this time are stale, after a restore
+
+    void      publishSample(uint8_t input, int16_t value);
+    int       readDeviceRegister(uint8_t reg, uint16_t* value);
+    uint16_t  readDeviceRegister(uint8_t reg);
+    int       writeDeviceRegister(uint8_t reg, uint16_t value);
+    void      transferDone(bool ok);
+    void      restoreConfig(bool restart);
+    int       startInput(uint8_t input);
 
 public:
     TLA2024(const char* i2cDeviceName = I2CDeviceDefaultName, uint8_t i2cAddress = I2CADDRESS_1);
+    virtual ~TLA2024() {}
     uint16_t readADC_SingleEnded(uint8_t channel);
     int16_t readADC_Differential_0_1(void);
     int16_t readADC_Differential_2_3(void);
+    int16_t readADC_Input(uint8_t input);
+    int     readADC_Input(uint8_t input, int16_t* value);
+    void    startADC_Input(uint8_t input);
+    void    startADC_Continuous(uint8_t input);
+    bool    isConversionReady(void);
+    int16_t readConversionResult(void);
+    int     readConversionResult(int16_t* value);
     int16_t getLastConversionResults();
     void updateI2cDevice(const char* i2cDeviceName);
     void setGain(adsGain_t gain);
@@ -213,6 +288,17 @@ public:
     void      setSps(adsSps_t sps);
     adsSps_t  getSps(void);
     void      setConversionDelay(void);
+    uint32_t  getConversionDelay(void);
+    uint8_t   getAdsType(void);
+    bool      isContinuous(void);
+    void      setSampleSink(adsSampleSink* sink);
+    void      setIio(adsIio* iio);
+    adsIio*   getIio(void);
+    void      setRecovery(bool enabled);
+    bool      isAvailable(void);
+    void      markReconnected(void);
+    const char* getI2cDeviceName(void);
+    uint8_t   getI2cAddress(void);
 
 private:
 };
@@ -241,3 +327,7 @@ public:
 
 private:
 };
+
+uint64_t adsTimestampNs(void);
+
+#endif // ADS1X15_TLA2024_H
@@ -0,0 +1,46 @@
+#include <cstdio>
+#include <unistd.h>
+#include "ADS1X15_BusScheduler.h"
+
+ADS1115 ads_bulk(I2CDeviceDefaultName, I2CADDRESS_1);
+ADS1015 ads_alarm(I2CDeviceDefaultName, I2CADDRESS_2);
+adsBusScheduler bus;
+
+/// Background scan of the 4 channels, each result queues the next one
+class BulkScan : public adsSampleSink {
+public:
+	void onSample(const adsSample_t& sample) {
+		bus.submit(&ads_bulk, ADS_INPUT_SINGLE((sample.input - ADS_INPUT_SINGLE_0 + 1) % 4), ADS_BUS_PRIORITY_BULK, this);
+	}
+} bulkScan;
+
+static void printStats(const char* name, uint8_t priority)
+{
+	adsBusStats_t stats = bus.stats(priority);
+	printf("%s: %llu reads, mean %llu us, max %llu us, %llu restarted\n", name, (unsigned long long)stats.completed,
+		(unsigned long long)(stats.completed ? stats.totalLatencyNs / stats.completed / 1000 : 0),
+		(unsigned long long)(stats.maxLatencyNs / 1000), (unsigned long long)stats.preempted);
+}
+
+int main()
+{
+	printf("A slow bulk scan runs on the first chip while the alarm channel of the second chip is read every 10 ms.\n\n");
+
+	ads_bulk.setSps(SPS_128);
+	if (bus.start() < 0)
+		return 1;
+	bus.submit(&ads_bulk, ADS_INPUT_SINGLE_0, ADS_BUS_PRIORITY_BULK, &bulkScan);
+
+	for (int i = 1; ; i++)
+	{
+		usleep(10000);
+		int16_t value = bus.read(&ads_alarm, ADS_INPUT_SINGLE_0, ADS_BUS_PRIORITY_URGENT);
+		if (value > 1000)
+			printf("ALARM: %d\n", value);
+
+		if (i % 100 == 0) {
+			printStats("urgent", ADS_BUS_PRIORITY_URGENT);
+			printStats("bulk  ", ADS_BUS_PRIORITY_BULK);
+		}
+	}
+}
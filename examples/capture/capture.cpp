@@ -0,0 +1,46 @@
+#include <cstdio>
+#include <poll.h>
+#include "ADS1X15_Acquisition.h"
+#include "ADS1X15_Capture.h"
+
+TLA2024 tla_sigleEnded(I2CDeviceDefaultName, I2CADDRESS_1);
+
+int main()
+{
+	printf("AIN0 is acquired continuously, 200 samples before and 100 after each rise above 1000 are printed.\n\n");
+
+	adsCapture capture(200, 100);
+	capture.setTrigger(ADS_CAPTURE_TRIGGER_RISING, 0, 1000);
+
+	adsAcquisition acquisition;
+	acquisition.addChannel(&tla_sigleEnded, ADS_INPUT_SINGLE_0);
+	acquisition.addSink(&capture);
+	if (acquisition.start() < 0)
+		return 1;
+
+	while (1)
+	{
+		// The capture runs inside drain(), the loop only collects the bursts
+		struct pollfd pfd;
+		pfd.fd = acquisition.fd();
+		pfd.events = POLLIN;
+		if (poll(&pfd, 1, -1) < 0)
+			return 1;
+
+		adsSample_t samples[16];
+		acquisition.drain(samples, 16);
+
+		adsCaptureSnapshot_t snapshot;
+		if (!capture.takeSnapshot(&snapshot))
+			continue;
+
+		printf("burst at %llu ns, %zu samples before the trigger:\n", (unsigned long long)snapshot.triggerNs, snapshot.preCount);
+		for (size_t i = 0; i < snapshot.firstCount + snapshot.secondCount; i++)
+		{
+			const adsSample_t& sample = i < snapshot.firstCount ? snapshot.first[i] : snapshot.second[i - snapshot.firstCount];
+			printf("%d%c", sample.value, i + 1 == snapshot.preCount ? '|' : ' ');
+		}
+		printf("\n");
+		capture.releaseSnapshot();
+	}
+}
@@ -0,0 +1,38 @@
+#include <cstdio>
+#include "ADS1X15_Codec.h"
+
+TLA2024 tla_sigleEnded(I2CDeviceDefaultName, I2CADDRESS_1);
+
+int main()
+{
+	printf("Captures AIN0..3 in blocks of 256 scans and appends them encoded to capture.adsb (%s kernel).\n\n", adsCodecKernel());
+
+	FILE* capture = fopen("capture.adsb", "ab");
+	if (!capture) {
+		perror("capture.adsb");
+		return 1;
+	}
+
+	uint8_t inputs[4] = { ADS_INPUT_SINGLE_0, ADS_INPUT_SINGLE_1, ADS_INPUT_SINGLE_2, ADS_INPUT_SINGLE_3 };
+	adsSampleBlock block;
+	block.create(inputs, 4, 256);
+
+	std::vector<uint8_t> encoded;
+	for (int i = 0; i < 10; i++)
+	{
+		block.clear();
+		adsReadBlock(tla_sigleEnded, block, 256);
+		adsEncodeBlock(block, ADS_CODEC_DELTA, encoded);
+
+		// Length prefix so the file can be read back block by block
+		uint32_t size = encoded.size();
+		fwrite(&size, sizeof(size), 1, capture);
+		fwrite(encoded.data(), 1, encoded.size(), capture);
+
+		size_t raw = block.size() * (sizeof(uint64_t) + block.channelCount() * sizeof(int16_t));
+		printf("block %d: %zu bytes -> %u bytes (%.1fx)\n", i, raw, size, (double)raw / size);
+	}
+
+	fclose(capture);
+	return 0;
+}
@@ -0,0 +1,49 @@
+#include <cstdio>
+#include "ADS1X15_Coro.h"
+
+TLA2024 tla_sigleEnded(I2CDeviceDefaultName, I2CADDRESS_1);
+TLA2024 tla_differential(I2CDeviceDefaultName, I2CADDRESS_2);
+
+adsCoroScheduler scheduler;
+adsCoroDevice adc_sigleEnded(scheduler, tla_sigleEnded);
+adsCoroDevice adc_differential(scheduler, tla_differential);
+
+const std::vector<uint8_t> scanInputs = { ADS_INPUT_SINGLE_0, ADS_INPUT_SINGLE_1, ADS_INPUT_SINGLE_2, ADS_INPUT_SINGLE_3 };
+
+// Each coroutine waits for its own conversions, the two chips convert in parallel
+adsTask singleEnded(int loops)
+{
+	for (int i = 0; i < loops; i++)
+	{
+		std::vector<int16_t> ain = co_await adc_sigleEnded.scan(scanInputs);
+		if (ain.empty())
+			co_return;
+		printf("AIN0: %d AIN1: %d AIN2: %d AIN3: %d\n", ain[0], ain[1], ain[2], ain[3]);
+	}
+}
+
+adsTask differential(int loops)
+{
+	for (int i = 0; i < loops; i++)
+	{
+		int16_t diff01, diff23;
+		if (co_await adc_differential.readInput(ADS_INPUT_DIFF_0_1, &diff01) < 0)
+			co_return;
+		if (co_await adc_differential.readInput(ADS_INPUT_DIFF_2_3, &diff23) < 0)
+			co_return;
+		printf("Differential_0_1: %d | Differential_2_3: %d\n", diff01, diff23);
+	}
+}
+
+int main()
+{
+	printf("Two coroutines reading two chips on a single thread.\n\n");
+
+	singleEnded(10);
+	differential(10);
+
+	// Resumes the coroutines as their conversions complete
+	scheduler.run();
+
+	return 0;
+}
@@ -0,0 +1,43 @@
+#include <cstdio>
+#include <poll.h>
+#include "ADS1X15_Acquisition.h"
+#include "ADS1X15_Deadband.h"
+#include "ADS1X15_Stats.h"
+
+TLA2024 tla_sigleEnded(I2CDeviceDefaultName, I2CADDRESS_1);
+
+int main()
+{
+	printf("AIN0..3 are scanned at full rate, a value is printed when it moves more than 8 codes or every 5 s.\n\n");
+
+	adsAcquisition acquisition;
+	for (uint8_t channel = 0; channel < 4; channel++)
+		acquisition.addChannel(&tla_sigleEnded, ADS_INPUT_SINGLE(channel));
+
+	// The statistics see every sample, the loop only the changes
+	adsStats stats(4);
+	adsDeadband deadband(4, 8, 5000);
+	acquisition.addSink(&stats);
+	acquisition.setFilter(&deadband);
+
+	if (acquisition.start() < 0)
+		return 1;
+
+	while (1)
+	{
+		struct pollfd pfd;
+		pfd.fd = acquisition.fd();
+		pfd.events = POLLIN;
+		if (poll(&pfd, 1, -1) < 0)
+			return 1;
+
+		adsSample_t samples[16];
+		size_t n = acquisition.drain(samples, 16);
+		for (size_t s = 0; s < n; s++)
+		{
+			const adsDeadbandStats_t& counters = deadband.stats(samples[s].channel);
+			printf("channel %d: %d (mean %.1f, %llu suppressed)\n", samples[s].channel, samples[s].value,
+				stats.channel(samples[s].channel).mean(), (unsigned long long)counters.suppressed);
+		}
+	}
+}
@@ -0,0 +1,56 @@
+#include <cstdio>
+#include <sys/epoll.h>
+#include <unistd.h>
+#include "ADS1X15_Acquisition.h"
+
+TLA2024 tla_sigleEnded(I2CDeviceDefaultName, I2CADDRESS_1);
+ADS1015 ads_comparator(I2CDeviceDefaultName, I2CADDRESS_2);
+
+int main()
+{
+	printf("Acquisition multiplexed with stdin on a single epoll loop.\n");
+	printf("AIN0..3 of the first chip are scanned, AIN0 of the second chip runs a comparator at 1000.\n");
+	printf("Type a line and press enter to show that stdin is served too.\n\n");
+
+	adsAcquisition acquisition;
+	for (uint8_t channel = 0; channel < 4; channel++)
+		acquisition.addChannel(&tla_sigleEnded, ADS_INPUT_SINGLE(channel));
+	acquisition.addComparator(&ads_comparator, 0, 1000);
+
+	if (acquisition.start() < 0)
+		return 1;
+
+	int epollFd = epoll_create1(0);
+	struct epoll_event event;
+	event.events = EPOLLIN;
+	event.data.fd = acquisition.fd();
+	epoll_ctl(epollFd, EPOLL_CTL_ADD, acquisition.fd(), &event);
+	event.data.fd = STDIN_FILENO;
+	epoll_ctl(epollFd, EPOLL_CTL_ADD, STDIN_FILENO, &event);
+
+	while (1)
+	{
+		struct epoll_event ready[2];
+		int count = epoll_wait(epollFd, ready, 2, -1);
+
+		for (int i = 0; i < count; i++)
+		{
+			if (ready[i].data.fd == acquisition.fd())
+			{
+				adsSample_t samples[16];
+				size_t n = acquisition.drain(samples, 16);
+				for (size_t s = 0; s < n; s++)
+					printf("channel %d: %d%s\n", samples[s].channel, samples[s].value, samples[s].alert ? " ALERT" : "");
+			}
+			else
+			{
+				char line[128];
+				ssize_t len = read(STDIN_FILENO, line, sizeof(line) - 1);
+				if (len <= 0)
+					return 0;
+				line[len] = '\0';
+				printf("stdin: %s", line);
+			}
+		}
+	}
+}
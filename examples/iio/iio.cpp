@@ -0,0 +1,36 @@
+#include <cstdio>
+#include "ADS1X15_Iio.h"
+
+// Bound by the kernel, e.g. echo ads1015 0x48 > /sys/bus/i2c/devices/i2c-1/new_device
+ADS1015 ads_iio("/dev/i2c-1", I2CADDRESS_1);
+
+int main()
+{
+	printf("Reading through the ti-ads1015 kernel driver.\n");
+	printf("Buffered capture needs an IIO trigger, e.g. mkdir /sys/kernel/config/iio/triggers/hrtimer/trigger0\n\n");
+
+	adsIio iio;
+	if (iio.open("/dev/i2c-1", I2CADDRESS_1) < 0)
+		return 1;
+	ads_iio.setIio(&iio);
+
+	for (uint8_t channel = 0; channel < 4; channel++)
+		printf("AIN%d: %d\n", channel, ads_iio.readADC_SingleEnded(channel));
+
+	// One read() per block of 64 scans, timestamped by the kernel
+	iio.setTrigger("trigger0");
+	uint8_t input = ADS_INPUT_SINGLE_0;
+	adsSampleBlock block;
+	block.create(&input, 1, 64);
+	for (int i = 0; i < 10; i++)
+	{
+		block.clear();
+		size_t rows = adsReadBlock(ads_iio, block, 64);
+		if (rows == 0)
+			return 1;
+		printf("block of %zu scans, AIN0 first %d last %d over %llu us\n", rows, block.column(0)[0], block.column(0)[rows - 1],
+			(unsigned long long)(block.timestamps()[rows - 1] - block.timestamps()[0]) / 1000);
+	}
+
+	return 0;
+}
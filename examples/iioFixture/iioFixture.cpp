@@ -0,0 +1,101 @@
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include "ADS1X15_Iio.h"
+
+// Runs the IIO transport against the fake sysfs and /dev trees of the
+// fixture directory: an ADS1015 at 1-0048 (iio:device0, 16 buffered scans
+// at 1 kHz) and an ADS1115 at 1-0049 (iio:device1).  The attributes are
+// written to, so run it on a copy: make check
+
+static int failures = 0;
+static std::string root;
+
+static void check(bool ok, const char* what)
+{
+	printf("%s %s\n", ok ? "ok  " : "FAIL", what);
+	if (!ok)
+		failures++;
+}
+
+// First line of an attribute of iio:device0
+static std::string attribute(const char* name)
+{
+	std::string path = root + "/sys/bus/iio/devices/iio:device0/" + name;
+	char line[64] = "";
+	FILE* file = fopen(path.c_str(), "r");
+	if (file) {
+		if (!fgets(line, sizeof(line), file))
+			line[0] = '\0';
+		fclose(file);
+	}
+	line[strcspn(line, "\n")] = '\0';
+	return line;
+}
+
+int main(int argc, char** argv)
+{
+	root = argc > 1 ? argv[1] : "run";
+	std::string sysfsRoot = root + "/sys/bus/iio/devices";
+	std::string devRoot = root + "/dev";
+
+	// Lookup through the i2c-N/N-00AA parent of the device links
+	adsIio iio(sysfsRoot.c_str(), devRoot.c_str());
+	check(iio.open("/dev/i2c-1", I2CADDRESS_2) > 0 && iio.index() == 1, "open 1-0049 finds iio:device1");
+	check(iio.open("/dev/i2c-2", I2CADDRESS_1) < 0, "open 2-0048 fails");
+	check(iio.openIndex(7) < 0 && !iio.isOpen(), "openIndex of a missing device fails");
+	check(iio.openIndex(1) > 0 && iio.index() == 1, "openIndex(1)");
+	check(iio.open("/dev/i2c-1", I2CADDRESS_1) > 0 && iio.index() == 0, "open 1-0048 finds iio:device0");
+
+	// Gain and data rate through the per-channel attributes
+	check(iio.configure(ADS_INPUT_SINGLE_0, ads1015, GAIN_ONE, SPS_3300) > 0, "configure AIN0");
+	check(attribute("in_voltage0_scale") == "2.000000", "AIN0 scale is 2 mV");
+	check(attribute("in_voltage0_sampling_frequency") == "3300", "AIN0 sampling_frequency is 3300");
+	check(iio.configure(ADS_INPUT_DIFF_2_3, ads1115, GAIN_SIXTEEN, SPS_128) > 0, "configure AIN2-AIN3");
+	check(attribute("in_voltage2-voltage3_scale") == "0.007813", "AIN2-AIN3 scale is 7.8125 uV");
+	check(attribute("in_voltage2-voltage3_sampling_frequency") == "8", "AIN2-AIN3 sampling_frequency is 8");
+
+	// Every input reads its own raw attribute, (index * 100 - 300)
+	bool raws = true;
+	for (uint8_t input = 0; input < ADS_INPUT_COUNT; input++)
+	{
+		int16_t value;
+		raws = raws && iio.readRaw(input, &value) > 0 && value == input * 100 - 300;
+	}
+	check(raws, "readRaw of the 8 inputs");
+
+	// Through the driver
+	ADS1015 ads("/dev/i2c-1", I2CADDRESS_1);
+	ads.setIio(&iio);
+	int16_t value;
+	check(ads.readADC_Input(ADS_INPUT_DIFF_0_1, &value) > 0 && value == -300, "readADC_Input(AIN0-AIN1)");
+	check(ads.readADC_SingleEnded(3) == 400, "readADC_SingleEnded(3)");
+
+	// Two blocks of 8 scans from the buffer, then the end of the data
+	iio.setTrigger("hrtimer0");
+	uint8_t input = ADS_INPUT_SINGLE_2;
+	adsSampleBlock block;
+	block.create(&input, 1, 16);
+	check(iio.readBlock(block, 8) == 8 && iio.scanBytes() == 16, "readBlock of 8 scans");
+	check(attribute("scan_elements/in_voltage2_en") == "1" && attribute("scan_elements/in_voltage0_en") == "0"
+		&& attribute("scan_elements/in_timestamp_en") == "1", "scan elements AIN2 and timestamp");
+	check(attribute("buffer/enable") == "1" && attribute("buffer/length") == "16" && attribute("buffer/watermark") == "8",
+		"buffer enabled with a watermark of 8");
+	check(attribute("trigger/current_trigger") == "hrtimer0" && attribute("current_timestamp_clock") == "monotonic",
+		"trigger and timestamp clock");
+	check(iio.readBlock(block, 8) == 8 && block.size() == 16, "second readBlock");
+
+	bool scans = true;
+	for (size_t i = 0; i < block.size(); i++)
+		scans = scans && block.column(0)[i] == (int)i * 100 - 800 && block.timestamps()[i] == 1000000000ULL + i * 1000000;
+	check(scans, "decoded 12-bit values and kernel timestamps");
+
+	block.clear();
+	check(iio.readBlock(block, 8) == 0, "readBlock at the end of the data");
+
+	iio.stopBuffer();
+	check(attribute("buffer/enable") == "0", "stopBuffer disables the buffer");
+
+	printf("%d failure(s)\n", failures);
+	return failures ? 1 : 0;
+}
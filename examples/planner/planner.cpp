@@ -0,0 +1,46 @@
+#include <cstdio>
+#include "ADS1X15_Planner.h"
+
+ADS1115 ads_slow(I2CDeviceDefaultName, I2CADDRESS_1);
+ADS1015 ads_fast(I2CDeviceDefaultName, I2CADDRESS_2);
+
+int main()
+{
+	printf("Plans 4 channels at 20 Hz on an ADS1115 and one channel at 1 kHz on an ADS1015.\n\n");
+
+	adsPlanner planner;
+	for (uint8_t channel = 0; channel < 4; channel++)
+		planner.addInput(&ads_slow, ADS_INPUT_SINGLE(channel), 20);
+	planner.addInput(&ads_fast, ADS_INPUT_SINGLE_0, 1000);
+
+	if (!planner.queryBusClock(I2CDeviceDefaultName))
+		planner.setBusClock(I2CDeviceDefaultName, ADS_BUS_CLOCK_FAST);
+	planner.measure(&ads_slow);
+	printf("kernel time per access: %u us\n", planner.getAccessCost());
+
+	int rc = planner.plan();
+	adsPlanReport_t report = planner.report();
+	printf("feasible: %s, bus %.1f%% (headroom %.1f%%), cpu %.1f%%, %.0f accesses/s, %u rows per block\n",
+		report.feasible ? "yes" : "no", report.busLoad * 100, report.busHeadroom * 100, report.cpuLoad * 100,
+		report.accessesPerSecond, report.batchRows);
+
+	TLA2024* devices[2] = { &ads_slow, &ads_fast };
+	for (int i = 0; i < 2; i++)
+	{
+		adsPlanDevice_t plan = planner.devicePlan(devices[i]);
+		printf("0x%02x: %s, data rate setting 0x%04x, converter %.1f%%, %u us of bus per conversion\n",
+			devices[i]->getI2cAddress(), plan.continuous ? "continuous" : "single-shot", plan.sps,
+			plan.converterLoad * 100, plan.busOverheadUs);
+	}
+
+	if (rc < 0 || planner.apply() < 0)
+		return 1;
+
+	for (int i = 0; i < 10; i++)
+	{
+		usleep(1000);
+		printf("%d\n", ads_fast.readConversionResult());
+	}
+
+	return 0;
+}
@@ -0,0 +1,37 @@
+#include <cstdio>
+#include <vector>
+#include "ADS1X15_Probe.h"
+
+static const char* buses[] = { "/dev/i2c-0", "/dev/i2c-1" };
+
+static const char* typeName(uint8_t adsType)
+{
+	switch (adsType) {
+	case ads1115: return "ADS1115";
+	case ads1015: return "ADS1015";
+	default:      return "TLA2024";
+	}
+}
+
+int main()
+{
+	printf("Scanning the i2c buses for ADS1015/ADS1115/TLA2024 chips...\n");
+
+	std::vector<adsProbeResult_t> found;
+	adsProbe(buses, sizeof(buses) / sizeof(buses[0]), found);
+
+	for (size_t i = 0; i < found.size(); i++)
+	{
+		printf("%s 0x%02X: %s\n", found[i].i2cDeviceName, found[i].i2cAddress, typeName(found[i].adsType));
+
+		// The driver is created with the right resolution and conversion delay
+		TLA2024* adc = adsCreate(found[i]);
+		printf("  AIN0: %d\n", adc->readADC_SingleEnded(0));
+		delete adc;
+	}
+
+	if (found.empty())
+		printf("No device found!\n");
+
+	return 0;
+}
@@ -0,0 +1,43 @@
+#include <cstdio>
+#include "ADS1X15_RateScheduler.h"
+
+ADS1115 ads_mixedRate(I2CDeviceDefaultName, I2CADDRESS_1);
+
+int main()
+{
+	printf("AIN0 at 200 Hz, AIN1 at 20 Hz and AIN2-AIN3 at 1 Hz on one multiplexer.\n");
+	printf("The slowest data rate meeting every rate is picked, then conversions run in EDF order.\n\n");
+
+	adsRateScheduler scheduler(ads_mixedRate);
+	scheduler.addInput(ADS_INPUT_SINGLE_0, 200);
+	scheduler.addInput(ADS_INPUT_SINGLE_1, 20);
+	scheduler.addInput(ADS_INPUT_DIFF_2_3, 1);
+	if (scheduler.plan() < 0)
+		return 1;
+
+	printf("Slot %u us, converter %.0f%% busy\n", scheduler.slotUs(), scheduler.utilization() * 100);
+
+	scheduler.start();
+	for (int second = 0; second < 10; second++)
+	{
+		// About one second of conversions: 200 + 20 + 1
+		for (int i = 0; i < 221; i++)
+		{
+			adsSample_t sample;
+			if (scheduler.step(&sample) < 0)
+				return 1;
+			if (sample.channel == 2)
+				printf("AIN2-AIN3: %d\n", sample.value);
+		}
+
+		for (uint8_t task = 0; task < scheduler.inputCount(); task++)
+		{
+			const adsRateStats_t& stats = scheduler.stats(task);
+			printf("  input %d: %llu conversions, %llu missed, worst jitter %llu us\n", task,
+				(unsigned long long)stats.conversions, (unsigned long long)stats.missed,
+				(unsigned long long)(stats.maxJitterNs / 1000));
+		}
+	}
+
+	return 0;
+}
@@ -0,0 +1,37 @@
+#include <cstdio>
+#include <unistd.h>
+#include "ADS1X15_Recovery.h"
+
+ADS1015 ads_comparator(I2CDeviceDefaultName, I2CADDRESS_2);
+
+int main()
+{
+	printf("Comparator on AIN0 at 1000, unplug and plug the chip back: reads stay fast during the outage\n");
+	printf("and the comparator setup is restored when the chip answers again.\n\n");
+
+	adsRecovery recovery;
+	recovery.addDevice(&ads_comparator);
+	if (recovery.start() < 0)
+		return 1;
+
+	ads_comparator.startComparator_SingleEnded(0, 1000);
+	bool wasAvailable = true;
+	while (1)
+	{
+		int16_t value = ads_comparator.getLastConversionResults();
+		bool available = ads_comparator.isAvailable();
+		if (available != wasAvailable) {
+			adsRecoveryStats_t stats = recovery.stats(&ads_comparator);
+			if (available)
+				printf("Back after %llu ms (%llu probes)\n", (unsigned long long)(stats.lastOutageNs / 1000000), (unsigned long long)stats.probes);
+			else
+				printf("Device lost\n");
+			wasAvailable = available;
+		}
+		else if (available) {
+			printf("AIN0: %d\n", value);
+		}
+
+		usleep(100000);
+	}
+}
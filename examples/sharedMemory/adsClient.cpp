@@ -0,0 +1,34 @@
+#include <cstdio>
+#include <unistd.h>
+#include "ADS1X15_ShmClient.h"
+
+int main()
+{
+	adsShmReader shm;
+	if (shm.open(ADS_SHM_DEFAULT_NAME) < 0)
+	{
+		printf("The sampling daemon is not running!\n");
+		return 1;
+	}
+
+	uint64_t cursor = 0;
+	while (1)
+	{
+		// Latest value of every channel, no i2c access involved
+		for (uint32_t i = 0; i < shm.channelCount(); i++)
+		{
+			adsShmChannel_t channel;
+			adsShmSample_t sample;
+			shm.channel(i, channel);
+			if (shm.readLatest(i, sample))
+				printf("%s 0x%02X input %d: %d\n", channel.i2cDeviceName, channel.i2cAddress, channel.input, sample.value);
+		}
+
+		// Everything published since the last call
+		adsShmSample_t history[256];
+		size_t count = shm.readHistory(cursor, history, 256);
+		printf("%d samples in the history since the last read\n\n", (int)count);
+
+		sleep(1);
+	}
+}
@@ -0,0 +1,73 @@
+#include <csignal>
+#include <cstdio>
+#include <unistd.h>
+#include "ADS1X15_Shm.h"
+
+// The daemon is the only process talking to the chips, clients only map
+// the shared memory (see adsClient.cpp)
+TLA2024 tla_sigleEnded(I2CDeviceDefaultName, I2CADDRESS_1);
+TLA2024 tla_differential(I2CDeviceDefaultName, I2CADDRESS_2);
+
+struct channel_t {
+	TLA2024* device;
+	uint8_t  input;
+};
+
+channel_t channels[] = {
+	{ &tla_sigleEnded,   ADS_INPUT_SINGLE_0 },
+	{ &tla_sigleEnded,   ADS_INPUT_SINGLE_1 },
+	{ &tla_sigleEnded,   ADS_INPUT_SINGLE_2 },
+	{ &tla_sigleEnded,   ADS_INPUT_SINGLE_3 },
+	{ &tla_differential, ADS_INPUT_DIFF_0_1 },
+	{ &tla_differential, ADS_INPUT_DIFF_2_3 },
+};
+
+#define CHANNEL_COUNT (sizeof(channels) / sizeof(channels[0]))
+
+static volatile sig_atomic_t running = 1;
+
+static void stop(int)
+{
+	running = 0;
+}
+
+int main()
+{
+	signal(SIGINT, stop);
+	signal(SIGTERM, stop);
+
+	adsShmWriter shm;
+	if (shm.create(ADS_SHM_DEFAULT_NAME, 4096) < 0)
+		return 1;
+
+	for (size_t i = 0; i < CHANNEL_COUNT; i++)
+		shm.addChannel(channels[i].device->getI2cDeviceName(), channels[i].device->getI2cAddress(),
+			channels[i].device->getAdsType(), channels[i].input,
+			channels[i].device->getGain(), channels[i].device->getSps());
+	shm.publishChannels();
+
+	printf("Publishing %d channels to %s, Ctrl+C to stop\n", (int)CHANNEL_COUNT, ADS_SHM_DEFAULT_NAME);
+
+	while (running)
+	{
+		int16_t  values[CHANNEL_COUNT];
+		uint64_t timestamps[CHANNEL_COUNT];
+
+		// Convert outside of the write section, readers never wait on the bus
+		for (size_t i = 0; i < CHANNEL_COUNT; i++)
+		{
+			values[i] = channels[i].device->readADC_Input(channels[i].input);
+			timestamps[i] = adsTimestampNs();
+		}
+
+		shm.beginUpdate();
+		for (size_t i = 0; i < CHANNEL_COUNT; i++)
+			shm.publish(i, values[i], timestamps[i]);
+		shm.endUpdate();
+
+		usleep(10 * 1000);
+	}
+
+	shm.destroy();
+	return 0;
+}
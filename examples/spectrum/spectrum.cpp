@@ -0,0 +1,51 @@
+#include <cstdio>
+#include <math.h>
+#include <poll.h>
+#include "ADS1X15_Acquisition.h"
+#include "ADS1X15_Spectrum.h"
+
+TLA2024 tla_sigleEnded(I2CDeviceDefaultName, I2CADDRESS_1);
+
+/// Prints the ripple band and the strongest peak of every frame
+class RippleReport : public adsSpectrumSink {
+public:
+	void onSpectrum(const adsSpectrum& spectrum, uint8_t channel) {
+		adsSpectrumPeak_t peak;
+		size_t n = spectrum.peaks(channel, &peak, 1);
+		printf("channel %d: 90-110 Hz ripple %.1f codes RMS", channel, sqrt(spectrum.bandEnergy(channel, 0)));
+		if (n)
+			printf(", peak at %.1f Hz (%.1f codes RMS)", peak.frequencyHz, sqrt(peak.power));
+		printf("\n");
+	}
+} rippleReport;
+
+int main()
+{
+	printf("AIN0 is acquired at 3300 SPS, 512-point frames with 50%% overlap give its spectrum.\n\n");
+
+	tla_sigleEnded.setSps(SPS_3300);
+
+	adsSpectrum spectrum(1, 512, 256);
+	spectrum.setSampleRate(3300);
+	spectrum.addBand(90, 110);
+	spectrum.addSink(&rippleReport);
+	printf("%s butterflies, %.2f Hz per bin\n", adsSpectrum::kernel(), spectrum.binHz());
+
+	adsAcquisition acquisition;
+	acquisition.addChannel(&tla_sigleEnded, ADS_INPUT_SINGLE_0);
+	acquisition.addSink(&spectrum);
+	if (acquisition.start() < 0)
+		return 1;
+
+	while (1)
+	{
+		struct pollfd pfd;
+		pfd.fd = acquisition.fd();
+		pfd.events = POLLIN;
+		if (poll(&pfd, 1, -1) < 0)
+			return 1;
+
+		adsSample_t samples[16];
+		acquisition.drain(samples, 16);
+	}
+}